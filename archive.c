@@ -0,0 +1,980 @@
+/*
+ * File:   archive.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Reads and writes the on-disk format of Far archives, and keeps an in-memory
+ * index of the entries in an archive.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "archive.h"
+#include "charBuffer.h"
+#include "fileCopy.h"
+
+#define ARCHIVE_MAGIC "\x7F" "FAR" // the first bytes of a version 2 archive
+#define ARCHIVE_INDEX_MAGIC "\x7F" "TOC" // the last bytes of the footer
+#define ARCHIVE_STREAM_MAGIC "\x7F" "FAS" // the first bytes of a stream
+#define MAGIC_LEN (4)
+
+// the offset of the number of entries in the header of a version 2 archive
+#define HEADER_NUM_ENTRIES_OFFSET (MAGIC_LEN + sizeof(unsigned int))
+
+// the number of bytes in the fields that follow the name in the header of an
+// entry of a streamed archive
+#define STREAM_FIELDS_LENGTH (2 * sizeof(unsigned char) + sizeof(uint64_t) + \
+                              sizeof(uint32_t) + sizeof(int64_t))
+
+// the number of bytes in the fields that follow the name in the header of an
+// entry of any other archive: those of a streamed one, then the checksum and
+// the body size
+#define ENTRY_FIELDS_LENGTH (STREAM_FIELDS_LENGTH + sizeof(uint32_t) + \
+                             sizeof(uint64_t))
+
+// the number of bytes in the footer
+#define FOOTER_LENGTH (2 * sizeof(uint64_t) + sizeof(unsigned int) + MAGIC_LEN)
+
+#define INIT_INDEX_SIZE (10)
+#define INDEX_GROWTH_FACTOR (2)
+
+// the most chunks per slot before the chunk table is made bigger
+#define CHUNK_MIN_SLOTS_PER_CHUNK (2)
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Returns the 32-bit FNV-1a hash of the len bytes starting at data. Used to
+ * detect a damaged index. */
+static unsigned int hashBytes(const char* data, unsigned int len)
+{
+    unsigned int hash = 2166136261u;
+
+    for(unsigned int i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Copies a nul-terminated string starting at the current file position in
+ * archive into the charBuffer named name. Returns 0 if successful,
+ * 1 if failed. */
+static int readName(FILE* archive, charBuffer* name)
+{
+    charBufferClear(name);
+
+    int c;
+    while((c = getc(archive)) != '\0')
+    {
+        if(c == EOF)
+        {
+            return 1; // failure
+        }
+        charBufferAppend(name, c);
+    }
+    charBufferAppend(name, c); // add final \0 to charBuffer
+
+    return 0; // success
+}
+
+/* Returns the number of bytes in the fields that follow the name in an entry
+ * header of an archive of the given version, from the flags through the body
+ * size. Index records hold the same fields followed by the body's offset. */
+static size_t entryFieldsLength(unsigned int version)
+{
+    return (version == ARCHIVE_LEGACY_VERSION) ? sizeof(unsigned int)
+                                               : ENTRY_FIELDS_LENGTH;
+}
+
+/* Returns the number of bytes that the header of entry takes up in an archive
+ * of the given version */
+static uint64_t entryHeaderLength(archiveEntry* entry, unsigned int version)
+{
+    return strlen(entry->name) + 1 + entryFieldsLength(version);
+}
+
+/* Parses the entryFieldsLength(version) bytes at the start of bytes, which
+ * follow the name in an entry header or index record of the given version,
+ * into entry. Legacy entries hold only the size of a body stored as it is,
+ * so they have no flags, mode, modification time or checksum. */
+static void parseEntryFields(const char* bytes,
+                             unsigned int version,
+                             archiveEntry* entry)
+{
+    if(version == ARCHIVE_LEGACY_VERSION)
+    {
+        unsigned int size;
+        memcpy(&size, bytes, sizeof(unsigned int));
+        entry->flags = 0;
+        entry->codec = CODEC_NONE;
+        entry->originalSize = size;
+        entry->mode = 0;
+        entry->mtime = 0;
+        entry->checksum = 0;
+        entry->size = size;
+        return;
+    }
+
+    entry->flags = bytes[0];
+    entry->codec = bytes[1];
+    bytes += 2 * sizeof(unsigned char);
+    memcpy(&(entry->originalSize), bytes, sizeof(uint64_t));
+    bytes += sizeof(uint64_t);
+    memcpy(&(entry->mode), bytes, sizeof(uint32_t));
+    bytes += sizeof(uint32_t);
+    memcpy(&(entry->mtime), bytes, sizeof(int64_t));
+    bytes += sizeof(int64_t);
+    memcpy(&(entry->checksum), bytes, sizeof(uint32_t));
+    bytes += sizeof(uint32_t);
+    memcpy(&(entry->size), bytes, sizeof(uint64_t));
+}
+
+/* Frees the names of the entries in index and empties it */
+static void archiveIndexClear(archiveIndex* index)
+{
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        free(index->entries[i].name);
+    }
+    index->numEntries = 0;
+    archiveIndexTruncateChunks(index, 0);
+}
+
+/* Returns the slot in index->chunkSlots that holds the chunk with the given
+ * hash, or the empty slot where it would go */
+static unsigned int findChunkSlot(archiveIndex* index, uint64_t hash)
+{
+    unsigned int mask = index->numChunkSlots - 1;
+    unsigned int slot = (hash ^ (hash >> 32)) & mask;
+
+    // linear probing; the table is never full, so this ends
+    while(index->chunkSlots[slot] != 0 &&
+          index->chunks[index->chunkSlots[slot] - 1].hash != hash)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Rebuilds index->chunkSlots with at least CHUNK_MIN_SLOTS_PER_CHUNK slots
+ * for each chunk plus one more */
+static void rebuildChunkSlots(archiveIndex* index)
+{
+    unsigned int numSlots = 1;
+    while(numSlots < (index->numChunks + 1) * CHUNK_MIN_SLOTS_PER_CHUNK)
+    {
+        numSlots *= 2;
+    }
+
+    free(index->chunkSlots);
+    index->chunkSlots = calloc(numSlots, sizeof(unsigned int));
+    index->numChunkSlots = numSlots;
+
+    for(unsigned int i = 0; i < index->numChunks; i++)
+    {
+        unsigned int slot = findChunkSlot(index, index->chunks[i].hash);
+        if(index->chunkSlots[slot] == 0)
+        {
+            index->chunkSlots[slot] = i + 1;
+        }
+    }
+}
+
+/* Returns a pointer to the len bytes at offset in the archive open as
+ * archive: into the mapping of map if map isn't NULL and is mapped, or else
+ * to buffer, which they are read into through archive.
+ * Returns NULL if the archive ends first or can't be read. */
+static const char* readBytes(FILE* archive,
+                             const fileMap* map,
+                             char* buffer,
+                             size_t len,
+                             uint64_t offset)
+{
+    if(map && map->data)
+    {
+        return fileMapRead(map, buffer, len, offset);
+    }
+
+    if(fseeko(archive, offset, SEEK_SET) < 0 ||
+       fread(buffer, sizeof(char), len, archive) < len)
+    {
+        return NULL;
+    }
+    return buffer;
+}
+
+/* Reads the header at the beginning of archive, through map if it's mapped,
+ * into version and numEntries, and sets *dataStart to the offset of the first
+ * entry.
+ * Returns 0 on success, -1 if the header is damaged or of an unknown
+ * version. */
+static int readHeader(FILE* archive,
+                      const fileMap* map,
+                      unsigned int* version,
+                      unsigned int* numEntries,
+                      uint64_t* dataStart)
+{
+    char bytes[HEADER_NUM_ENTRIES_OFFSET + sizeof(uint64_t)];
+    const char* header = readBytes(archive, map, bytes, MAGIC_LEN, 0);
+
+    if(!header)
+    {
+        return -1;
+    }
+
+    if(memcmp(header, ARCHIVE_MAGIC, MAGIC_LEN) != 0)
+    {
+        // version 1 archives begin with the number of entries
+        *version = ARCHIVE_LEGACY_VERSION;
+        memcpy(numEntries, header, sizeof(unsigned int));
+        *dataStart = sizeof(unsigned int);
+        return (*numEntries > ARCHIVE_MAX_ENTRIES) ? -1 : 0;
+    }
+
+    header = readBytes(archive, map, bytes, HEADER_NUM_ENTRIES_OFFSET, 0);
+    if(!header)
+    {
+        return -1;
+    }
+    memcpy(version, &(header[MAGIC_LEN]), sizeof(unsigned int));
+
+    *dataStart = HEADER_NUM_ENTRIES_OFFSET + sizeof(uint64_t);
+    if(*version != ARCHIVE_VERSION ||
+       !(header = readBytes(archive, map, bytes, *dataStart, 0)))
+    {
+        return -1;
+    }
+
+    uint64_t count;
+    memcpy(&count, &(header[HEADER_NUM_ENTRIES_OFFSET]), sizeof(uint64_t));
+    if(count > ARCHIVE_MAX_ENTRIES)
+    {
+        return -1;
+    }
+    *numEntries = count;
+    return 0;
+}
+
+/* Reads the index and footer at the end of archive, through map if it's
+ * mapped, into index. numEntries is the number of entries according to the
+ * header and dataStart is the offset of the first entry.
+ * Returns 0 on success, -1 if the index is missing or damaged. */
+static int readIndex(FILE* archive,
+                     const fileMap* map,
+                     archiveIndex* index,
+                     unsigned int numEntries,
+                     uint64_t dataStart)
+{
+    char mapped = map && map->data;
+    off_t fileEnd = mapped ? (off_t)map->length : fileLength(archive);
+    uint64_t indexOffset; // the offset of the index, read from the footer
+    uint64_t footerNumEntries; // the number of entries in the index
+    unsigned int indexHash; // the hash of the index, read from the footer
+    char footerBytes[FOOTER_LENGTH];
+
+    if(fileEnd < 0 || (uint64_t)fileEnd < dataStart + FOOTER_LENGTH)
+    {
+        return -1;
+    }
+    uint64_t footerOffset = fileEnd - FOOTER_LENGTH;
+
+    // read and check the footer
+    const char* footer = readBytes(archive, map, footerBytes, FOOTER_LENGTH,
+                                   footerOffset);
+    if(!footer)
+    {
+        return -1;
+    }
+    memcpy(&indexOffset, footer, sizeof(uint64_t));
+    footer += sizeof(uint64_t);
+    memcpy(&footerNumEntries, footer, sizeof(uint64_t));
+    footer += sizeof(uint64_t);
+    memcpy(&indexHash, footer, sizeof(unsigned int));
+    footer += sizeof(unsigned int);
+
+    if(memcmp(footer, ARCHIVE_INDEX_MAGIC, MAGIC_LEN) != 0 ||
+       footerNumEntries != numEntries ||
+       indexOffset < dataStart ||
+       indexOffset > footerOffset)
+    {
+        return -1;
+    }
+
+    // check the hash of the whole index, which is parsed straight from the
+    // mapping if there is one, or else read into memory
+    size_t indexLen = footerOffset - indexOffset;
+    char* buffer = mapped ? NULL : malloc(indexLen + 1);
+    if(!mapped && !buffer)
+    {
+        return -1;
+    }
+    const char* indexBytes = readBytes(archive, map, buffer, indexLen,
+                                       indexOffset);
+    if(!indexBytes || hashBytes(indexBytes, indexLen) != indexHash)
+    {
+        free(buffer);
+        return -1;
+    }
+
+    // parse the index records, checking that every body lies between the
+    // header and the index without overlapping the previous body
+    size_t position = 0;
+    uint64_t previousEnd = dataStart;
+    for(unsigned int i = 0; i < numEntries; i++)
+    {
+        archiveEntry entry;
+        entry.name = (char*)&(indexBytes[position]);
+        const char* nameEnd = memchr(entry.name, '\0', indexLen - position);
+
+        if(!nameEnd)
+        {
+            free(buffer);
+            return -1;
+        }
+        position += nameEnd - entry.name + 1;
+
+        if(indexLen - position < ENTRY_FIELDS_LENGTH + sizeof(uint64_t))
+        {
+            free(buffer);
+            return -1;
+        }
+        parseEntryFields(&(indexBytes[position]), ARCHIVE_VERSION, &entry);
+        position += ENTRY_FIELDS_LENGTH;
+        memcpy(&(entry.offset), &(indexBytes[position]), sizeof(uint64_t));
+        position += sizeof(uint64_t);
+
+        if(entry.offset < previousEnd ||
+           entry.offset > indexOffset ||
+           entry.size > indexOffset - entry.offset)
+        {
+            free(buffer);
+            return -1;
+        }
+        previousEnd = entry.offset + entry.size;
+
+        archiveIndexAdd(index, &entry);
+    }
+
+    // then the chunk table, whose chunks must also lie among the bodies
+    uint64_t numChunks;
+    archiveChunk chunk;
+
+    if(indexLen - position < sizeof(uint64_t))
+    {
+        free(buffer);
+        return -1;
+    }
+    memcpy(&numChunks, &(indexBytes[position]), sizeof(uint64_t));
+    position += sizeof(uint64_t);
+
+    if(numChunks > ARCHIVE_MAX_ENTRIES ||
+       (indexLen - position) / (2 * sizeof(uint64_t)) < numChunks)
+    {
+        free(buffer);
+        return -1;
+    }
+    for(uint64_t i = 0; i < numChunks; i++)
+    {
+        memcpy(&(chunk.hash), &(indexBytes[position]), sizeof(uint64_t));
+        position += sizeof(uint64_t);
+        memcpy(&(chunk.offset), &(indexBytes[position]), sizeof(uint64_t));
+        position += sizeof(uint64_t);
+
+        if(chunk.offset < dataStart || chunk.offset >= indexOffset)
+        {
+            free(buffer);
+            return -1;
+        }
+        archiveIndexAddChunk(index, chunk.hash, chunk.offset);
+    }
+
+    free(buffer);
+    index->dataEnd = indexOffset;
+    return (position == indexLen) ? 0 : -1;
+}
+
+/* Reads the header of each of the numEntries entries starting at dataStart
+ * in archive into index, skipping over the bodies. With a mapped map, the
+ * headers are parsed straight from the mapping.
+ * Returns 0 on success, -1 if the archive is corrupted. */
+static int readEntryHeaders(FILE* archive,
+                            const fileMap* map,
+                            archiveIndex* index,
+                            unsigned int numEntries,
+                            uint64_t dataStart)
+{
+    char mapped = map && map->data;
+    off_t fileEnd = mapped ? (off_t)map->length : fileLength(archive);
+    charBuffer* name = charBufferNew();
+    size_t fieldsSize = entryFieldsLength(index->version);
+    char fieldBytes[2 * sizeof(unsigned char) + 2 * sizeof(uint64_t) +
+                    2 * sizeof(uint32_t) + sizeof(int64_t)];
+    uint64_t position = dataStart; // the start of the next entry
+
+    if(fileEnd < 0)
+    {
+        charBufferDelete(name);
+        return -1;
+    }
+
+    // the headers are spread among the bodies, from front to back
+    if(mapped)
+    {
+        fileMapAdvise(map, dataStart, fileEnd - dataStart,
+                      FILEMAP_SEQUENTIAL);
+    }
+
+    for(unsigned int i = 0; i < numEntries; i++)
+    {
+        archiveEntry entry;
+        const char* fields;
+
+        if(mapped)
+        {
+            const char* nameEnd = (position >= map->length) ? NULL :
+                                  memchr(&(map->data[position]), '\0',
+                                         map->length - position);
+            if(!nameEnd)
+            {
+                charBufferDelete(name);
+                return -1;
+            }
+            entry.name = (char*)&(map->data[position]);
+            position += nameEnd - entry.name + 1;
+        }
+        else
+        {
+            if(fseeko(archive, position, SEEK_SET) < 0 ||
+               readName(archive, name))
+            {
+                charBufferDelete(name);
+                return -1;
+            }
+            entry.name = name->str;
+            position += strlen(name->str) + 1;
+        }
+
+        fields = readBytes(archive, map, fieldBytes, fieldsSize, position);
+        if(!fields)
+        {
+            charBufferDelete(name);
+            return -1;
+        }
+        parseEntryFields(fields, index->version, &entry);
+        position += fieldsSize;
+
+        if(entry.size > (uint64_t)fileEnd - position)
+        {
+            charBufferDelete(name);
+            return -1; // the body runs past the end of the archive
+        }
+        entry.offset = position;
+        position += entry.size;
+
+        archiveIndexAdd(index, &entry);
+    }
+
+    index->dataEnd = position;
+    charBufferDelete(name);
+    return 0;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+archiveIndex* archiveIndexNew()
+{
+    archiveIndex* index = malloc(sizeof(archiveIndex));
+
+    if(!index)
+    {
+        return NULL;
+    }
+
+    index->sizeEntries = INIT_INDEX_SIZE;
+    index->entries = malloc(sizeof(archiveEntry) * INIT_INDEX_SIZE);
+    index->numEntries = 0;
+    index->chunks = NULL;
+    index->numChunks = 0;
+    index->sizeChunks = 0;
+    index->chunkSlots = NULL;
+    rebuildChunkSlots(index);
+    index->version = ARCHIVE_VERSION;
+    index->dataEnd = 0;
+    return index;
+}
+
+void archiveIndexDelete(archiveIndex* index)
+{
+    archiveIndexClear(index);
+    free(index->entries);
+    free(index->chunks);
+    free(index->chunkSlots);
+    free(index);
+}
+
+void archiveIndexAdd(archiveIndex* index, const archiveEntry* entry)
+{
+    if(index->numEntries == index->sizeEntries)
+    {
+        index->sizeEntries *= INDEX_GROWTH_FACTOR;
+        index->entries = realloc(index->entries,
+                                 sizeof(archiveEntry) * index->sizeEntries);
+    }
+
+    archiveEntry* newEntry = &(index->entries[index->numEntries]);
+    *newEntry = *entry;
+    newEntry->name = malloc(sizeof(char) * (strlen(entry->name) + 1));
+    strcpy(newEntry->name, entry->name);
+    index->numEntries++;
+}
+
+void archiveIndexRemoveLast(archiveIndex* index)
+{
+    if(index->numEntries > 0)
+    {
+        index->numEntries--;
+        free(index->entries[index->numEntries].name);
+    }
+}
+
+void archiveIndexAddChunk(archiveIndex* index, uint64_t hash,
+                          uint64_t offset)
+{
+    if(index->numChunks == index->sizeChunks)
+    {
+        index->sizeChunks = (index->sizeChunks > 0) ?
+                            index->sizeChunks * INDEX_GROWTH_FACTOR :
+                            INIT_INDEX_SIZE;
+        index->chunks = realloc(index->chunks,
+                                sizeof(archiveChunk) * index->sizeChunks);
+    }
+
+    index->chunks[index->numChunks].hash = hash;
+    index->chunks[index->numChunks].offset = offset;
+    index->numChunks++;
+
+    if(index->numChunks * CHUNK_MIN_SLOTS_PER_CHUNK > index->numChunkSlots)
+    {
+        rebuildChunkSlots(index);
+    }
+    else
+    {
+        unsigned int slot = findChunkSlot(index, hash);
+        if(index->chunkSlots[slot] == 0)
+        {
+            index->chunkSlots[slot] = index->numChunks;
+        }
+    }
+}
+
+int archiveIndexFindChunk(archiveIndex* index, uint64_t hash)
+{
+    return (int)index->chunkSlots[findChunkSlot(index, hash)] - 1;
+}
+
+void archiveIndexTruncateChunks(archiveIndex* index, unsigned int numChunks)
+{
+    if(numChunks < index->numChunks)
+    {
+        index->numChunks = numChunks;
+        rebuildChunkSlots(index);
+    }
+}
+
+int archiveIndexFindOffset(archiveIndex* index, uint64_t offset)
+{
+    // every entry has a header, so offsets increase from entry to entry
+    unsigned int low = 0;
+    unsigned int high = index->numEntries;
+
+    while(low < high)
+    {
+        unsigned int middle = low + (high - low) / 2;
+        if(index->entries[middle].offset < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if(low < index->numEntries && index->entries[low].offset == offset)
+    {
+        return low;
+    }
+    return -1;
+}
+
+int archiveLinkTarget(int fd, archiveIndex* index, unsigned int linkIndex)
+{
+    archiveEntry* link = &(index->entries[linkIndex]);
+    uint64_t targetOffset;
+
+    if(link->size != ARCHIVE_LINK_SIZE ||
+       fileReadAt(fd, (char*)&targetOffset, ARCHIVE_LINK_SIZE,
+                  link->offset) < 0)
+    {
+        return -1;
+    }
+
+    int target = archiveIndexFindOffset(index, targetOffset);
+    if(target < 0 || (unsigned int)target >= linkIndex ||
+       (index->entries[target].flags & ENTRY_LINK))
+    {
+        return -1;
+    }
+    return target;
+}
+
+archiveIndex* archiveIndexRead(FILE* archive, const fileMap* map)
+{
+    unsigned int version; // the version of archive
+    unsigned int numEntries; // the number of entries according to the header
+    uint64_t dataStart; // the offset of the first entry
+
+    if(readHeader(archive, map, &version, &numEntries, &dataStart) < 0)
+    {
+        return NULL;
+    }
+
+    archiveIndex* index = archiveIndexNew();
+    index->version = version;
+
+    if(version == ARCHIVE_VERSION &&
+       readIndex(archive, map, index, numEntries, dataStart) == 0)
+    {
+        return index;
+    }
+
+    // the index is missing or damaged, so walk the entries from the front
+    archiveIndexClear(index);
+    if(readEntryHeaders(archive, map, index, numEntries, dataStart) < 0)
+    {
+        archiveIndexDelete(index);
+        return NULL;
+    }
+    return index;
+}
+
+int archiveWriteHeader(FILE* archive)
+{
+    unsigned int version = ARCHIVE_VERSION;
+    uint64_t numEntries = 0; // overwritten by archiveWriteIndex
+
+    if(fwrite(ARCHIVE_MAGIC, sizeof(char), MAGIC_LEN, archive) < MAGIC_LEN ||
+       fwrite(&version, sizeof(unsigned int), 1, archive) < 1 ||
+       fwrite(&numEntries, sizeof(uint64_t), 1, archive) < 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int archiveWriteEntryHeader(FILE* archive,
+                            archiveIndex* index,
+                            const archiveEntry* entry)
+{
+    size_t nameSize = strlen(entry->name) + 1;
+
+    if(fwrite(entry->name, sizeof(char), nameSize, archive) < nameSize ||
+       fwrite(&(entry->flags), sizeof(unsigned char), 1, archive) < 1 ||
+       fwrite(&(entry->codec), sizeof(unsigned char), 1, archive) < 1 ||
+       fwrite(&(entry->originalSize), sizeof(uint64_t), 1, archive) < 1 ||
+       fwrite(&(entry->mode), sizeof(uint32_t), 1, archive) < 1 ||
+       fwrite(&(entry->mtime), sizeof(int64_t), 1, archive) < 1 ||
+       fwrite(&(entry->checksum), sizeof(uint32_t), 1, archive) < 1 ||
+       fwrite(&(entry->size), sizeof(uint64_t), 1, archive) < 1)
+    {
+        return -1;
+    }
+
+    off_t offset = ftello(archive);
+    if(offset < 0)
+    {
+        return -1;
+    }
+
+    archiveEntry newEntry = *entry;
+    newEntry.offset = offset;
+    archiveIndexAdd(index, &newEntry);
+    return 0;
+}
+
+int archiveFinishEntry(FILE* archive,
+                       archiveIndex* index,
+                       unsigned int entryIndex,
+                       uint64_t size,
+                       uint32_t checksum)
+{
+    archiveEntry* entry = &(index->entries[entryIndex]);
+    entry->size = size;
+    entry->checksum = checksum;
+
+    // the checksum and size are the last fields of the entry header, just
+    // before the body
+    if(fseeko(archive, entry->offset - sizeof(uint64_t) - sizeof(uint32_t),
+              SEEK_SET) < 0 ||
+       fwrite(&checksum, sizeof(uint32_t), 1, archive) < 1 ||
+       fwrite(&size, sizeof(uint64_t), 1, archive) < 1 ||
+       fseeko(archive, entry->offset + size, SEEK_SET) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int archiveWriteIndex(FILE* archive, archiveIndex* index)
+{
+    off_t indexOffset = ftello(archive);
+    charBuffer* indexBytes = charBufferNew();
+    uint64_t numEntries = index->numEntries;
+    uint64_t numChunks = index->numChunks;
+
+    if(indexOffset < 0)
+    {
+        charBufferDelete(indexBytes);
+        return -1;
+    }
+
+    // lay out the index in memory so that it can be hashed and written at once
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        archiveEntry* entry = &(index->entries[i]);
+        charBufferAppendBytes(indexBytes, entry->name, strlen(entry->name) + 1);
+        charBufferAppendBytes(indexBytes, &(entry->flags),
+                              sizeof(unsigned char));
+        charBufferAppendBytes(indexBytes, &(entry->codec),
+                              sizeof(unsigned char));
+        charBufferAppendBytes(indexBytes, &(entry->originalSize),
+                              sizeof(uint64_t));
+        charBufferAppendBytes(indexBytes, &(entry->mode), sizeof(uint32_t));
+        charBufferAppendBytes(indexBytes, &(entry->mtime), sizeof(int64_t));
+        charBufferAppendBytes(indexBytes, &(entry->checksum),
+                              sizeof(uint32_t));
+        charBufferAppendBytes(indexBytes, &(entry->size), sizeof(uint64_t));
+        charBufferAppendBytes(indexBytes, &(entry->offset), sizeof(uint64_t));
+    }
+    charBufferAppendBytes(indexBytes, &numChunks, sizeof(uint64_t));
+    for(unsigned int i = 0; i < index->numChunks; i++)
+    {
+        charBufferAppendBytes(indexBytes, &(index->chunks[i].hash),
+                              sizeof(uint64_t));
+        charBufferAppendBytes(indexBytes, &(index->chunks[i].offset),
+                              sizeof(uint64_t));
+    }
+
+    uint64_t footerIndexOffset = indexOffset;
+    unsigned int indexHash = hashBytes(indexBytes->str, indexBytes->len);
+
+    int result = 0;
+    if(fwrite(indexBytes->str, sizeof(char), indexBytes->len, archive) <
+           indexBytes->len ||
+       fwrite(&footerIndexOffset, sizeof(uint64_t), 1, archive) < 1 ||
+       fwrite(&numEntries, sizeof(uint64_t), 1, archive) < 1 ||
+       fwrite(&indexHash, sizeof(unsigned int), 1, archive) < 1 ||
+       fwrite(ARCHIVE_INDEX_MAGIC, sizeof(char), MAGIC_LEN, archive) <
+           MAGIC_LEN)
+    {
+        result = -1;
+    }
+
+    // drop whatever was past the new footer, and make sure the entries and
+    // index are on disk before the header points readers at them
+    if(result == 0 &&
+       (fflush(archive) == EOF ||
+        ftruncate(fileno(archive), ftello(archive)) < 0 ||
+        fsync(fileno(archive)) < 0))
+    {
+        result = -1;
+    }
+
+    // record the number of entries in the header, which commits the index
+    if(result == 0 &&
+       (fseeko(archive, HEADER_NUM_ENTRIES_OFFSET, SEEK_SET) < 0 ||
+        fwrite(&numEntries, sizeof(uint64_t), 1, archive) < 1 ||
+        fflush(archive) == EOF ||
+        fsync(fileno(archive)) < 0))
+    {
+        result = -1;
+    }
+
+    charBufferDelete(indexBytes);
+    return result;
+}
+
+int archiveMarkDeleted(FILE* archive, archiveIndex* index,
+                       unsigned int entryIndex)
+{
+    archiveEntry* entry = &(index->entries[entryIndex]);
+    entry->flags |= ENTRY_DELETED;
+
+    // the flags are the first of the fields between the name and the body
+    uint64_t flagsOffset = entry->offset - ENTRY_FIELDS_LENGTH;
+
+    if(fseeko(archive, flagsOffset, SEEK_SET) < 0 ||
+       fwrite(&(entry->flags), sizeof(unsigned char), 1, archive) < 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t archiveDeadSpace(archiveIndex* index, unsigned int* numDeleted)
+{
+    uint64_t deadSpace = 0;
+    *numDeleted = 0;
+
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        archiveEntry* entry = &(index->entries[i]);
+        if(entry->flags & ENTRY_DELETED)
+        {
+            deadSpace += entryHeaderLength(entry, index->version) +
+                         entry->size;
+            (*numDeleted)++;
+        }
+    }
+    return deadSpace;
+}
+
+int archiveStreamWriteHeader(FILE* stream, archiveIndex* index)
+{
+    unsigned int version = ARCHIVE_VERSION;
+
+    if(fwrite(ARCHIVE_STREAM_MAGIC, sizeof(char), MAGIC_LEN, stream) <
+           MAGIC_LEN ||
+       fwrite(&version, sizeof(unsigned int), 1, stream) < 1)
+    {
+        return -1;
+    }
+    index->version = version;
+    index->dataEnd = MAGIC_LEN + sizeof(unsigned int);
+    return 0;
+}
+
+int archiveStreamWriteEntryHeader(FILE* stream,
+                                  archiveIndex* index,
+                                  const archiveEntry* entry)
+{
+    size_t nameSize = strlen(entry->name) + 1;
+
+    if(fwrite(entry->name, sizeof(char), nameSize, stream) < nameSize ||
+       fwrite(&(entry->flags), sizeof(unsigned char), 1, stream) < 1 ||
+       fwrite(&(entry->codec), sizeof(unsigned char), 1, stream) < 1 ||
+       fwrite(&(entry->originalSize), sizeof(uint64_t), 1, stream) < 1 ||
+       fwrite(&(entry->mode), sizeof(uint32_t), 1, stream) < 1 ||
+       fwrite(&(entry->mtime), sizeof(int64_t), 1, stream) < 1)
+    {
+        return -1;
+    }
+
+    archiveEntry newEntry = *entry;
+    newEntry.offset = index->dataEnd + nameSize + STREAM_FIELDS_LENGTH;
+    archiveIndexAdd(index, &newEntry);
+    index->dataEnd = newEntry.offset;
+    return 0;
+}
+
+int archiveStreamWriteTrailer(FILE* stream,
+                              archiveIndex* index,
+                              uint64_t size,
+                              uint32_t checksum)
+{
+    archiveEntry* entry = &(index->entries[index->numEntries - 1]);
+    entry->size = size;
+    entry->checksum = checksum;
+    index->dataEnd = entry->offset + size + sizeof(uint32_t);
+
+    return (fwrite(&checksum, sizeof(uint32_t), 1, stream) < 1) ? -1 : 0;
+}
+
+int archiveStreamWriteEnd(FILE* stream)
+{
+    return (putc('\0', stream) == EOF || fflush(stream) == EOF) ? -1 : 0;
+}
+
+int archiveStreamReadHeader(FILE* stream, archiveIndex* index)
+{
+    char magic[MAGIC_LEN];
+    unsigned int version;
+
+    if(fread(magic, sizeof(char), MAGIC_LEN, stream) < MAGIC_LEN ||
+       memcmp(magic, ARCHIVE_STREAM_MAGIC, MAGIC_LEN) != 0 ||
+       fread(&version, sizeof(unsigned int), 1, stream) < 1 ||
+       version != ARCHIVE_VERSION)
+    {
+        return -1;
+    }
+    index->version = version;
+    index->dataEnd = MAGIC_LEN + sizeof(unsigned int);
+    return 0;
+}
+
+int archiveStreamReadEntryHeader(FILE* stream, archiveIndex* index)
+{
+    charBuffer* name = charBufferNew();
+    archiveEntry entry;
+
+    if(readName(stream, name))
+    {
+        charBufferDelete(name);
+        return -1;
+    }
+    else if(name->str[0] == '\0') // the end of the archive
+    {
+        charBufferDelete(name);
+        return 0;
+    }
+
+    entry.name = name->str;
+    if(fread(&(entry.flags), sizeof(unsigned char), 1, stream) < 1 ||
+       fread(&(entry.codec), sizeof(unsigned char), 1, stream) < 1 ||
+       fread(&(entry.originalSize), sizeof(uint64_t), 1, stream) < 1 ||
+       fread(&(entry.mode), sizeof(uint32_t), 1, stream) < 1 ||
+       fread(&(entry.mtime), sizeof(int64_t), 1, stream) < 1 ||
+       (entry.flags & ENTRY_DELETED) ||
+       (entry.codec != CODEC_NONE && !codecFind(entry.codec)) ||
+       ((entry.flags & ENTRY_LINK) && entry.codec != CODEC_NONE))
+    {
+        charBufferDelete(name);
+        return -1;
+    }
+
+    // the sizes of all but compressed bodies follow from the header
+    if(entry.flags & ENTRY_LINK)
+    {
+        entry.size = ARCHIVE_LINK_SIZE;
+    }
+    else
+    {
+        entry.size = (entry.codec == CODEC_NONE) ? entry.originalSize : 0;
+    }
+    entry.checksum = 0;
+    entry.offset = index->dataEnd + name->len + STREAM_FIELDS_LENGTH;
+
+    archiveIndexAdd(index, &entry);
+    index->dataEnd = entry.offset;
+    charBufferDelete(name);
+    return 1;
+}
+
+int archiveStreamReadTrailer(FILE* stream, archiveIndex* index, uint64_t size)
+{
+    archiveEntry* entry = &(index->entries[index->numEntries - 1]);
+    entry->size = size;
+    index->dataEnd = entry->offset + size + sizeof(uint32_t);
+
+    return (fread(&(entry->checksum), sizeof(uint32_t), 1, stream) < 1) ? -1
+                                                                        : 0;
+}
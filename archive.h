@@ -0,0 +1,257 @@
+/*
+ * File:   archive.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Reads and writes the on-disk format of Far archives, and keeps an in-memory
+ * index of the entries in an archive.
+ *
+ * An archive of the current version (2) is laid out as
+ *     header:  ARCHIVE_MAGIC, unsigned int version, uint64_t numEntries
+ *     entries: numEntries records of a nul-terminated name, an unsigned char
+ *              of ENTRY_ flags, an unsigned char CODEC_ id, a uint64_t
+ *              original size, a uint32_t mode, an int64_t modification
+ *              time, a uint32_t checksum, a uint64_t body size, and the body
+ *     index:   numEntries records of a nul-terminated name, an unsigned char
+ *              of ENTRY_ flags, an unsigned char CODEC_ id, a uint64_t
+ *              original size, a uint32_t mode, an int64_t modification
+ *              time, a uint32_t checksum, a uint64_t body size, and the
+ *              uint64_t offset of the body, followed by a uint64_t
+ *              numChunks and numChunks records of the uint64_t hash and
+ *              uint64_t offset of a chunk stored in the entries, as used by
+ *              dedup.h
+ *     footer:  uint64_t offset of the index, uint64_t numEntries,
+ *              unsigned int hash of the index, ARCHIVE_INDEX_MAGIC
+ * The body of an entry whose codec isn't CODEC_NONE is laid out as described
+ * in codec.h, or in dedup.h for CODEC_DEDUP. The body of an ENTRY_LINK entry
+ * is the uint64_t offset of the body of an earlier entry for the same file.
+ * The checksum is the crc32c.h checksum of the original file, and is only
+ * meaningful in an entry with ENTRY_CHECKSUMMED set. The mode and
+ * modification time are those of the file when it was added. An archive of
+ * version 1 (the original format) has no magic, version or index; it is only
+ * an unsigned int numEntries followed by entries of a nul-terminated name,
+ * an unsigned int body size and the body.
+ *
+ * A streamed archive is written and read from front to back without seeking,
+ * so that it can be sent through a pipe. It is laid out as
+ *     header:  ARCHIVE_STREAM_MAGIC, unsigned int version
+ *     entries: records of a nul-terminated name that isn't empty, an
+ *              unsigned char of ENTRY_ flags, an unsigned char CODEC_ id, a
+ *              uint64_t original size, a uint32_t mode, an int64_t
+ *              modification time, the body, and a uint32_t checksum
+ *     end:     an empty name, i.e. a single nul
+ * Since no size can be patched in later, a body's size follows from its
+ * header: a body stored as it is holds the original size in bytes, a
+ * compressed body holds as many blocks as it takes to make up the original
+ * size, and the body of an ENTRY_LINK entry is the uint64_t offset, from the
+ * beginning of the stream, of the body of an earlier entry. Streamed
+ * archives don't use CODEC_DEDUP or ENTRY_DELETED.
+ */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include "codec.h"
+#include "fileMap.h"
+
+#define ARCHIVE_VERSION (2) // the version of the archives that Far writes
+#define ARCHIVE_LEGACY_VERSION (1) // archives with no header or index
+
+// the most entries, and the most chunks, an archive may have. The counts on
+// disk are 64 bits wide, but an archiveIndex counts in unsigned ints and its
+// lookups return ints, so archives with more are rejected as damaged.
+#define ARCHIVE_MAX_ENTRIES (INT_MAX)
+
+// flags of an archiveEntry
+#define ENTRY_DELETED (0x01) // the entry was deleted in place; skip it
+#define ENTRY_LINK (0x02) // a hard link to the file of an earlier entry
+#define ENTRY_CHECKSUMMED (0x04) // the checksum of the file was stored
+
+// the size in bytes of the body of an ENTRY_LINK entry
+#define ARCHIVE_LINK_SIZE (sizeof(uint64_t))
+
+typedef struct
+{
+    char* name; // the nul-terminated name of the entry
+    unsigned char flags; // ENTRY_ flags of the entry
+    unsigned char codec; // the CODEC_ id that the body is stored with
+    uint64_t originalSize; // the size in bytes of the file that was added
+    uint64_t size; // the size in bytes of the entry's body
+    uint64_t offset; // the position of the entry's body in the archive
+    uint32_t checksum; // the crc32c.h checksum of the file that was added
+    uint32_t mode; // the type and permission bits of the file, or 0 if
+                   // they weren't stored
+    int64_t mtime; // the time the file's contents were last modified, in
+                   // seconds since the epoch
+} archiveEntry;
+
+// a chunk of file data that entries in the archive may share
+typedef struct
+{
+    uint64_t hash; // the hash of the chunk's original bytes
+    uint64_t offset; // the position in the archive of the chunk's record
+} archiveChunk;
+
+typedef struct
+{
+    archiveEntry* entries; // the entries in the order they appear
+    unsigned int numEntries; // the number of elements in entries
+    unsigned int sizeEntries; // the malloc'd size of entries
+    archiveChunk* chunks; // the shared chunks in the order they were stored
+    unsigned int numChunks; // the number of elements in chunks
+    unsigned int sizeChunks; // the malloc'd size of chunks
+    unsigned int* chunkSlots; // hash table of 1 + the index in chunks of
+                              // each slot's chunk, or 0 for an empty slot
+    unsigned int numChunkSlots; // the number of chunkSlots, a power of 2
+    unsigned int version; // the version of the archive that was read
+    uint64_t dataEnd; // the offset just past the last body in the archive
+} archiveIndex;
+
+/* mallocs an empty archiveIndex and returns a pointer to it.
+ * Returns NULL upon failure. */
+archiveIndex* archiveIndexNew();
+
+// Frees an archiveIndex and the names of its entries
+void archiveIndexDelete(archiveIndex* index);
+
+/* Adds a copy of entry, with a copy of its name, to the end of index */
+void archiveIndexAdd(archiveIndex* index, const archiveEntry* entry);
+
+// Removes the last entry from index
+void archiveIndexRemoveLast(archiveIndex* index);
+
+/* Adds a chunk with the given hash whose record is at offset to index. Only
+ * the first chunk with any hash can be found with archiveIndexFindChunk. */
+void archiveIndexAddChunk(archiveIndex* index, uint64_t hash,
+                          uint64_t offset);
+
+/* Returns the index in index->chunks of the chunk with the given hash, or -1
+ * if there's none. */
+int archiveIndexFindChunk(archiveIndex* index, uint64_t hash);
+
+/* Removes the chunks added to index after the first numChunks, for when the
+ * data they point at is thrown away */
+void archiveIndexTruncateChunks(archiveIndex* index, unsigned int numChunks);
+
+/* Returns the index in index->entries of the entry whose body is at offset,
+ * or -1 if there's none. */
+int archiveIndexFindOffset(archiveIndex* index, uint64_t offset);
+
+/* Returns the index in index->entries of the entry that the ENTRY_LINK entry
+ * at linkIndex is a link to, reading its body from the archive open as fd.
+ * Returns -1 if the link is damaged: its target must be an earlier entry
+ * that isn't a link itself. */
+int archiveLinkTarget(int fd, archiveIndex* index, unsigned int linkIndex);
+
+/* Reads the index of the archive open in archive. The index at the end of
+ * the archive is used when it's present and intact; otherwise every entry
+ * header is read from the front of the archive. If map isn't NULL and holds a
+ * mapping of archive, everything is parsed straight from the mapping instead
+ * of being read through archive.
+ * Returns a malloc'd archiveIndex, or NULL if the archive is corrupted. */
+archiveIndex* archiveIndexRead(FILE* archive, const fileMap* map);
+
+/* Writes the header of an archive with no entries at the current position
+ * of archive, which should be the beginning of the file.
+ * Returns 0 on success, -1 on failure. */
+int archiveWriteHeader(FILE* archive);
+
+/* Writes the header of entry at the current position of archive and adds the
+ * entry to index with its offset set to the position of the body. The body
+ * should be written right after this call.
+ * Returns 0 on success, -1 on failure. */
+int archiveWriteEntryHeader(FILE* archive,
+                            archiveIndex* index,
+                            const archiveEntry* entry);
+
+/* Sets the body size and checksum of the entry at entryIndex in index, both
+ * in index and in the entry's header in archive, for bodies whose size and
+ * checksum aren't known until they have been written. Leaves archive
+ * positioned just past the body.
+ * Returns 0 on success, -1 on failure. */
+int archiveFinishEntry(FILE* archive,
+                       archiveIndex* index,
+                       unsigned int entryIndex,
+                       uint64_t size,
+                       uint32_t checksum);
+
+/* Writes index and the footer at the current position of archive, which
+ * should be just past the last body, and truncates anything after them.
+ * Once they are on disk, updates the number of entries in the archive's
+ * header and syncs it too. Until that last write, readers see the header's
+ * old number of entries, which doesn't match the new footer, and so read only
+ * the entries that were in the archive before from their headers; this makes
+ * it safe to append entries to an archive in place. archive must be of the
+ * current version.
+ * Returns 0 on success, -1 on failure. */
+int archiveWriteIndex(FILE* archive, archiveIndex* index);
+
+/* Marks the entry at entryIndex in index as deleted, both in index and in
+ * the entry's header in archive, without moving any data. archive must be
+ * open for writing and of the current version. The entry
+ * should already be flagged ENTRY_DELETED in an index written with
+ * archiveWriteIndex: readers that can't use the index read the entries from
+ * their headers, and a header marked before the new index is on disk would
+ * hide the entry from them before the change that deletes it is committed.
+ * Returns 0 on success, -1 on failure. */
+int archiveMarkDeleted(FILE* archive, archiveIndex* index,
+                       unsigned int entryIndex);
+
+/* Returns the number of bytes in the archive described by index that are
+ * taken up by deleted entries, and sets *numDeleted to the number of deleted
+ * entries. */
+uint64_t archiveDeadSpace(archiveIndex* index, unsigned int* numDeleted);
+
+/* Writes the header of a streamed archive at the current position of stream,
+ * which should be the beginning of it, and sets index->dataEnd to the number
+ * of bytes written. index->dataEnd tracks the position of stream from then
+ * on, since a pipe has none. Returns 0 on success, -1 on failure. */
+int archiveStreamWriteHeader(FILE* stream, archiveIndex* index);
+
+/* Writes the header of entry to the end of the streamed archive stream and
+ * adds the entry to index with its offset set to the position of the body.
+ * The body should be written right after this call, followed by
+ * archiveStreamWriteTrailer. Returns 0 on success, -1 on failure. */
+int archiveStreamWriteEntryHeader(FILE* stream,
+                                  archiveIndex* index,
+                                  const archiveEntry* entry);
+
+/* Writes the checksum that ends the last entry of index to stream, after its
+ * size-byte body, and sets the size and checksum of the entry in index.
+ * Returns 0 on success, -1 on failure. */
+int archiveStreamWriteTrailer(FILE* stream,
+                              archiveIndex* index,
+                              uint64_t size,
+                              uint32_t checksum);
+
+/* Writes the end of the streamed archive stream, after its last entry.
+ * Returns 0 on success, -1 on failure. */
+int archiveStreamWriteEnd(FILE* stream);
+
+/* Reads the header of a streamed archive from the current position of
+ * stream, which should be the beginning of it, setting index->version and
+ * index->dataEnd as archiveStreamWriteHeader does.
+ * Returns 0 on success, -1 if stream doesn't begin with the header of a
+ * streamed archive of a known version; the bytes read are consumed either
+ * way. */
+int archiveStreamReadHeader(FILE* stream, archiveIndex* index);
+
+/* Reads the header of the next entry of the streamed archive stream and adds
+ * the entry to index with its offset set to the position of the body. Its
+ * size is set if the header gives it, which is every body but a compressed
+ * one, and is 0 otherwise. The body should be read or skipped right after
+ * this call, followed by archiveStreamReadTrailer. Returns 1 if an entry was
+ * read, 0 at the end of the archive, or -1 if the stream is damaged or cut
+ * short. */
+int archiveStreamReadEntryHeader(FILE* stream, archiveIndex* index);
+
+/* Reads the checksum that ends the last entry of index from stream, after
+ * its size-byte body, and sets the size and checksum of the entry in index.
+ * Returns 0 on success, -1 if the stream is cut short. */
+int archiveStreamReadTrailer(FILE* stream, archiveIndex* index, uint64_t size);
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * File:   benchFar.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Times the keys of Far on trees made by genTree, and reports the throughput
+ * and peak memory of each.
+ *
+ * Usage: benchFar [-l LABEL] [-n RUNS] [-f OPTIONS] FAR DIR TREE...
+ * Each TREE is a directory in DIR. For each one, the Far executable FAR is
+ * run from DIR to add the tree to a new archive (r), list it (t), extract it
+ * into a fresh directory (x) and delete every other file from it (d), RUNS
+ * times over (3 by default). OPTIONS, split at spaces, are passed to every
+ * run of Far. The fastest run of each key and the largest peak resident set
+ * of any run are written to stdout as one JSON object per line:
+ *     {"label": LABEL, "tree": TREE, "key": KEY, "files": N, "bytes": N,
+ *      "runs": N, "seconds": S, "mb_per_s": S, "files_per_s": S,
+ *      "peak_rss_kb": N, "status": N}
+ * where files and bytes count the regular files in the tree, whose total the
+ * rates are measured against for every key, and status is the exit status of
+ * the last failed run, or 0. LABEL (empty by default) names the build being
+ * measured, such as a commit, so that results can be appended to one file
+ * and compared. A table of the same results is printed to stderr.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// the most file descriptors that nftw holds open at once
+#define WALK_FDS (64)
+
+// the most options that -f passes to Far
+#define MAX_FAR_OPTIONS (32)
+
+// the keys that are timed, in the order they run
+#define NUM_KEYS (4)
+static const char* keys[NUM_KEYS] = {"r", "t", "x", "d"};
+
+// the best result of a key on a tree over every run
+typedef struct
+{
+    double seconds; // the time of the fastest run
+    long peakRssKb; // the largest peak resident set of any run, in KiB
+    int status; // the exit status of the last failed run, or 0
+} keyResult;
+
+// what is counted while walking a tree
+static uint64_t treeFiles; // the number of regular files
+static uint64_t treeBytes; // the total size of the regular files
+static FILE* deleteList; // where every other file's name is written for 'd'
+
+/* An nftw callback that counts the regular files in a tree and lists every
+ * other one in deleteList, each name followed by a NUL */
+int countFile(const char* name, const struct stat* info, int type,
+              struct FTW* walk)
+{
+    if(type == FTW_F && S_ISREG(info->st_mode))
+    {
+        if(treeFiles % 2 == 0)
+        {
+            fwrite(name, sizeof(char), strlen(name) + 1, deleteList);
+        }
+        treeFiles++;
+        treeBytes += info->st_size;
+    }
+    return 0;
+}
+
+/* An nftw callback that removes each file and directory it's given */
+int removeFile(const char* name, const struct stat* info, int type,
+               struct FTW* walk)
+{
+    return remove(name);
+}
+
+/* Removes the file or the tree named name, if it exists */
+void removeTree(const char* name)
+{
+    struct stat info;
+
+    if(lstat(name, &info) == 0)
+    {
+        nftw(name, removeFile, WALK_FDS, FTW_DEPTH | FTW_PHYS);
+    }
+}
+
+/* Runs the program args[0] with the arguments args from the directory dir,
+ * with its stdout thrown away, and waits for it. Sets *seconds to the time it
+ * took and *peakRssKb to its peak resident set in KiB.
+ * Returns its exit status, or -1 if it couldn't be run. */
+int runTimed(char** args, const char* dir, double* seconds, long* peakRssKb)
+{
+    struct timespec start, end;
+    struct rusage usage;
+    int status;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if(child < 0)
+    {
+        return -1;
+    }
+    else if(child == 0)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        if(chdir(dir) < 0 || devNull < 0 || dup2(devNull, 1) < 0)
+        {
+            _exit(127);
+        }
+        execv(args[0], args);
+        _exit(127);
+    }
+
+    if(wait4(child, &status, 0, &usage) < 0)
+    {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *seconds = (end.tv_sec - start.tv_sec) +
+               (end.tv_nsec - start.tv_nsec) / 1e9;
+    *peakRssKb = usage.ru_maxrss;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Runs every key once on the tree named tree, which is in the current
+ * directory, with the Far executable far and its options, and folds the
+ * times and memory into results */
+void runKeys(char* far,
+             char** options,
+             unsigned int numOptions,
+             const char* tree,
+             keyResult* results)
+{
+    char archive[4096]; // the archive made of the tree
+    char extracted[4096]; // the directory the archive is extracted into
+    char relArchive[4096 + 3]; // archive, from extracted
+    char manifest[4096]; // the names that 'd' deletes
+    char* args[MAX_FAR_OPTIONS + 8];
+
+    snprintf(archive, sizeof(archive), "%s.far", tree);
+    snprintf(extracted, sizeof(extracted), "%s.out", tree);
+    snprintf(relArchive, sizeof(relArchive), "../%s", archive);
+    snprintf(manifest, sizeof(manifest), "%s.del", tree);
+
+    removeTree(archive);
+    removeTree(extracted);
+    mkdir(extracted, 0777);
+
+    for(unsigned int k = 0; k < NUM_KEYS; k++)
+    {
+        unsigned int numArgs = 0;
+        const char* dir = ".";
+
+        args[numArgs++] = far;
+        for(unsigned int i = 0; i < numOptions; i++)
+        {
+            args[numArgs++] = options[i];
+        }
+        if(k == 3)
+        {
+            args[numArgs++] = "-T";
+            args[numArgs++] = manifest;
+        }
+        args[numArgs++] = (char*)keys[k];
+
+        if(k == 2)
+        {
+            args[numArgs++] = relArchive;
+            dir = extracted;
+        }
+        else
+        {
+            args[numArgs++] = archive;
+        }
+        if(k == 0)
+        {
+            args[numArgs++] = (char*)tree;
+        }
+        args[numArgs] = NULL;
+
+        double seconds;
+        long peakRssKb;
+        int status = runTimed(args, dir, &seconds, &peakRssKb);
+        if(status != 0)
+        {
+            fprintf(stderr, "Far %s failed on %s with status %d\n", keys[k],
+                    tree, status);
+            results[k].status = status;
+            continue;
+        }
+
+        if(results[k].seconds < 0 || seconds < results[k].seconds)
+        {
+            results[k].seconds = seconds;
+        }
+        if(peakRssKb > results[k].peakRssKb)
+        {
+            results[k].peakRssKb = peakRssKb;
+        }
+    }
+
+    removeTree(extracted);
+    removeTree(archive);
+}
+
+/* Prints a JSON string holding str to stdout */
+void printJsonString(const char* str)
+{
+    putchar('"');
+    for(; *str != '\0'; str++)
+    {
+        if(*str == '"' || *str == '\\')
+        {
+            printf("\\%c", *str);
+        }
+        else if((unsigned char)*str < 0x20)
+        {
+            printf("\\u%04x", *str);
+        }
+        else
+        {
+            putchar(*str);
+        }
+    }
+    putchar('"');
+}
+
+/* Prints the results of every key on the tree named tree, as described at
+ * the top of this file */
+void printResults(const char* label,
+                  const char* tree,
+                  unsigned int runs,
+                  keyResult* results)
+{
+    for(unsigned int k = 0; k < NUM_KEYS; k++)
+    {
+        double seconds = (results[k].seconds > 0) ? results[k].seconds : 0;
+        double mbPerSecond = (seconds > 0) ?
+                             treeBytes / (1024.0 * 1024.0) / seconds : 0;
+        double filesPerSecond = (seconds > 0) ? treeFiles / seconds : 0;
+
+        printf("{\"label\": ");
+        printJsonString(label);
+        printf(", \"tree\": ");
+        printJsonString(tree);
+        printf(", \"key\": \"%s\", \"files\": %" PRIu64 ", \"bytes\": %"
+               PRIu64 ", \"runs\": %u, \"seconds\": %.6f, \"mb_per_s\": %.2f"
+               ", \"files_per_s\": %.1f, \"peak_rss_kb\": %ld"
+               ", \"status\": %d}\n",
+               keys[k], treeFiles, treeBytes, runs, seconds, mbPerSecond,
+               filesPerSecond, results[k].peakRssKb, results[k].status);
+
+        fprintf(stderr, "%-8s %s %10.3f s %10.2f MB/s %12.1f files/s "
+                "%10ld KiB\n", tree, keys[k], seconds, mbPerSecond,
+                filesPerSecond, results[k].peakRssKb);
+    }
+    fflush(stdout);
+}
+
+/* Called if benchFar isn't passed valid arguments. Prints a message to
+ * stderr. */
+void usageError()
+{
+    fprintf(stderr, "Usage: benchFar [-l label] [-n runs] [-f options] "
+            "far dir tree...\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* label = "";
+    unsigned int runs = 3;
+    char* options[MAX_FAR_OPTIONS];
+    unsigned int numOptions = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "l:n:f:")) != -1)
+    {
+        if(opt == 'l')
+        {
+            label = optarg;
+        }
+        else if(opt == 'n' && atoi(optarg) > 0)
+        {
+            runs = atoi(optarg);
+        }
+        else if(opt == 'f')
+        {
+            for(char* option = strtok(optarg, " "); option;
+                option = strtok(NULL, " "))
+            {
+                if(numOptions == MAX_FAR_OPTIONS)
+                {
+                    usageError();
+                    return 1;
+                }
+                options[numOptions++] = option;
+            }
+        }
+        else
+        {
+            usageError();
+            return 1;
+        }
+    }
+    if(argc - optind < 3)
+    {
+        usageError();
+        return 1;
+    }
+
+    // Far is run from dir, so it's found by its full path
+    char* far = realpath(argv[optind], NULL);
+    if(!far || chdir(argv[optind + 1]) < 0)
+    {
+        fprintf(stderr, "Cannot find Far or the directory of trees\n");
+        free(far);
+        return 1;
+    }
+
+    for(int t = optind + 2; t < argc; t++)
+    {
+        const char* tree = argv[t];
+        char manifest[4096];
+        keyResult results[NUM_KEYS];
+
+        // count the tree, and list the files that 'd' deletes
+        snprintf(manifest, sizeof(manifest), "%s.del", tree);
+        treeFiles = 0;
+        treeBytes = 0;
+        deleteList = fopen(manifest, "wb");
+        if(!deleteList || nftw(tree, countFile, WALK_FDS, FTW_PHYS) < 0)
+        {
+            fprintf(stderr, "Cannot read tree: %s\n", tree);
+            if(deleteList) fclose(deleteList);
+            continue;
+        }
+        fclose(deleteList);
+
+        for(unsigned int k = 0; k < NUM_KEYS; k++)
+        {
+            results[k].seconds = -1;
+            results[k].peakRssKb = 0;
+            results[k].status = 0;
+        }
+        for(unsigned int run = 0; run < runs; run++)
+        {
+            runKeys(far, options, numOptions, tree, results);
+        }
+        printResults(label, tree, runs, results);
+
+        remove(manifest);
+    }
+
+    free(far);
+    return 0;
+}
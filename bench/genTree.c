@@ -0,0 +1,274 @@
+/*
+ * File:   genTree.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Generates the synthetic file trees that Far is benchmarked on. The same
+ * kind and scale always give the same tree, byte for byte, so results can be
+ * compared across commits.
+ *
+ * Usage: genTree tiny|huge|deep|wide DIR [SCALE]
+ *     tiny: many small files spread over a few hundred directories
+ *     huge: a few very large files
+ *     deep: a long chain of nested directories, with files at every level
+ *     wide: one directory holding a great many files
+ * SCALE (default 1) multiplies the number of files, or the size of the huge
+ * ones. Files hold a mix of text, which compresses well, and random bytes,
+ * which don't.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// the number of bytes generated and written at once
+#define WRITE_SIZE (64 * 1024)
+
+// tiny: files per directory, directories, and the largest file
+#define TINY_FILES_PER_DIR (100)
+#define TINY_DIRS (200)
+#define TINY_MAX_SIZE (2048)
+
+// huge: files and the size of each
+#define HUGE_FILES (4)
+#define HUGE_SIZE (64 * 1024 * 1024)
+
+// deep: nested directories, the files in each and the size of each
+#define DEEP_LEVELS (100)
+#define DEEP_FILES_PER_LEVEL (4)
+#define DEEP_SIZE (8 * 1024)
+
+// wide: files and the size of each
+#define WIDE_FILES (50000)
+#define WIDE_SIZE (256)
+
+// the words that text is made of
+static const char* words[] =
+{
+    "archive", "entry", "index", "offset", "block", "chunk", "file", "name",
+    "size", "mode", "time", "checksum", "header", "footer", "body", "codec",
+    "{\"id\": ", "\"level\": \"info\", ", "\"msg\": \"", "\", ", "}\n",
+    "the ", "of ", "and ", "to ", "in ", "0", "1", "2", "42", "\n", " "
+};
+
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ULL; // the state of nextRandom
+
+/* Returns the next number of a fixed pseudo-random sequence */
+uint64_t nextRandom()
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+/* Fills the len bytes at buffer with text if text is nonzero, or else with
+ * random bytes */
+void fillBuffer(char* buffer, size_t len, char text)
+{
+    size_t filled = 0;
+
+    while(filled < len)
+    {
+        if(text)
+        {
+            const char* word = words[nextRandom() % NUM_WORDS];
+            size_t wordLen = strlen(word);
+            if(wordLen > len - filled)
+            {
+                wordLen = len - filled;
+            }
+            memcpy(buffer + filled, word, wordLen);
+            filled += wordLen;
+        }
+        else
+        {
+            uint64_t bytes = nextRandom();
+            size_t n = (len - filled < sizeof(bytes)) ? len - filled
+                                                       : sizeof(bytes);
+            memcpy(buffer + filled, &bytes, n);
+            filled += n;
+        }
+    }
+}
+
+/* Creates the file named name holding size generated bytes, of which the
+ * first half is text and the rest random. Returns 0 on success, -1 on
+ * failure. */
+int writeFile(const char* name, uint64_t size)
+{
+    static char buffer[WRITE_SIZE];
+    FILE* file = fopen(name, "wb");
+    uint64_t written = 0;
+
+    if(!file)
+    {
+        fprintf(stderr, "Cannot create file: %s\n", name);
+        return -1;
+    }
+
+    while(written < size)
+    {
+        size_t len = (size - written < WRITE_SIZE) ? size - written
+                                                   : WRITE_SIZE;
+        fillBuffer(buffer, len, written < size / 2);
+        if(fwrite(buffer, sizeof(char), len, file) < len)
+        {
+            fclose(file);
+            fprintf(stderr, "Cannot write file: %s\n", name);
+            return -1;
+        }
+        written += len;
+    }
+
+    return (fclose(file) == 0) ? 0 : -1;
+}
+
+/* Creates the directory named name unless it exists.
+ * Returns 0 on success, -1 on failure. */
+int makeDir(const char* name)
+{
+    if(mkdir(name, 0777) < 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Cannot create directory: %s\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/* Each of these generates the tree of its kind at the given scale in the
+ * directory dir. Returns 0 on success, -1 on failure. */
+int generateTiny(char* dir, unsigned int scale)
+{
+    char name[4096];
+
+    for(unsigned int d = 0; d < TINY_DIRS * scale; d++)
+    {
+        snprintf(name, sizeof(name), "%s/dir%u", dir, d);
+        if(makeDir(name) < 0)
+        {
+            return -1;
+        }
+        for(unsigned int f = 0; f < TINY_FILES_PER_DIR; f++)
+        {
+            snprintf(name, sizeof(name), "%s/dir%u/file%u", dir, d, f);
+            if(writeFile(name, nextRandom() % (TINY_MAX_SIZE + 1)) < 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int generateHuge(char* dir, unsigned int scale)
+{
+    char name[4096];
+
+    for(unsigned int f = 0; f < HUGE_FILES; f++)
+    {
+        snprintf(name, sizeof(name), "%s/huge%u", dir, f);
+        if(writeFile(name, (uint64_t)HUGE_SIZE * scale) < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int generateDeep(char* dir, unsigned int scale)
+{
+    char path[4096];
+    char name[4096 + 32];
+    size_t pathLen = snprintf(path, sizeof(path), "%s", dir);
+
+    for(unsigned int level = 0; level < DEEP_LEVELS; level++)
+    {
+        pathLen += snprintf(path + pathLen, sizeof(path) - pathLen, "/l%u",
+                            level);
+        if(pathLen >= sizeof(path) || makeDir(path) < 0)
+        {
+            return -1;
+        }
+        for(unsigned int f = 0; f < DEEP_FILES_PER_LEVEL * scale; f++)
+        {
+            snprintf(name, sizeof(name), "%s/file%u", path, f);
+            if(writeFile(name, DEEP_SIZE) < 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int generateWide(char* dir, unsigned int scale)
+{
+    char name[4096];
+
+    for(unsigned int f = 0; f < WIDE_FILES * scale; f++)
+    {
+        snprintf(name, sizeof(name), "%s/file%u", dir, f);
+        if(writeFile(name, WIDE_SIZE) < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    long scale = 1;
+    char* end = NULL;
+
+    if(argc == 4)
+    {
+        scale = strtol(argv[3], &end, 10);
+    }
+    if(argc < 3 || argc > 4 || (end && (end == argv[3] || *end != '\0')) ||
+       scale < 1)
+    {
+        fprintf(stderr, "Usage: genTree tiny|huge|deep|wide DIR [SCALE]\n");
+        return 1;
+    }
+
+    if(makeDir(argv[2]) < 0)
+    {
+        return 1;
+    }
+
+    int result;
+    if(strcmp(argv[1], "tiny") == 0)
+    {
+        result = generateTiny(argv[2], scale);
+    }
+    else if(strcmp(argv[1], "huge") == 0)
+    {
+        result = generateHuge(argv[2], scale);
+    }
+    else if(strcmp(argv[1], "deep") == 0)
+    {
+        result = generateDeep(argv[2], scale);
+    }
+    else if(strcmp(argv[1], "wide") == 0)
+    {
+        result = generateWide(argv[2], scale);
+    }
+    else
+    {
+        fprintf(stderr, "Unknown kind of tree: %s\n", argv[1]);
+        return 1;
+    }
+
+    return (result < 0) ? 1 : 0;
+}
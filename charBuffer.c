@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "charBuffer.h"
 
 #define CHARBUFFER_INIT_SIZE (10)
@@ -67,6 +68,20 @@ charBuffer* charBufferAppend(charBuffer* buf, char c)
     return buf;
 }
 
+charBuffer* charBufferAppendBytes(charBuffer* buf, const void* data,
+                                  unsigned int len)
+{
+    while(buf->size - buf->len < len)
+    {
+        charBufferGrow(buf);
+    }
+    
+    memcpy(&(buf->str[buf->len]), data, len);
+    buf->len += len;
+    
+    return buf;
+}
+
 charBuffer* charBufferGrow(charBuffer* buf)
 {
     buf->size *= CHARBUFFER_GROWTH_FACTOR;
@@ -32,6 +32,11 @@ void charBufferDelete(charBuffer* buf);
  * necessary. Returns a pointer to the modified charBuffer. */
 charBuffer* charBufferAppend(charBuffer* buf, char c);
 
+/* Appends len bytes starting at data to the end of the given charBuffer,
+ * growing it if necessary. Returns a pointer to the modified charBuffer. */
+charBuffer* charBufferAppendBytes(charBuffer* buf, const void* data,
+                                  unsigned int len);
+
 /* grows the given charBuffer by an internal constant factor and returns
  * a pointer to it. */
 charBuffer* charBufferGrow(charBuffer* buf);
@@ -0,0 +1,562 @@
+/*
+ * File:   codec.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Compresses and decompresses the bodies of archive entries in blocks.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "codec.h"
+#include "fileCopy.h"
+#include "lz.h"
+#include "crc32c.h"
+
+// the size in bytes of the header of each block
+#define BLOCK_HEADER_SIZE (2 * sizeof(unsigned int))
+
+// the number of blocks compressed at once for each thread in the pool
+#define BLOCKS_PER_THREAD (2)
+
+#define INIT_BLOCKTABLE_SIZE (16)
+#define BLOCKTABLE_GROWTH_FACTOR (2)
+
+// every codec Far knows; add new ones here with a new CODEC_ id
+static const codec codecs[] =
+{
+    {CODEC_LZ, "lz", lzCompress, lzDecompress}
+};
+
+#define NUM_CODECS (sizeof(codecs) / sizeof(codec))
+
+// one block being compressed
+typedef struct
+{
+    const codec* compressor; // the codec to compress with
+    char* original; // the block's bytes from the file
+    unsigned int originalSize; // the number of bytes in original
+    char* stored; // room for the compressed bytes
+    unsigned int storedSize; // the number of bytes in stored; originalSize
+                             // if the block is stored as it is
+} codecBlock;
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* A threadPoolTask that compresses one codecBlock */
+static void codecCompressBlock(void* blockArg)
+{
+    codecBlock* block = blockArg;
+
+    size_t storedSize = 0;
+
+    // only keep the compressed bytes if they are smaller
+    if(block->originalSize > 1)
+    {
+        storedSize = block->compressor->compress(block->original,
+                                                 block->originalSize,
+                                                 block->stored,
+                                                 block->originalSize - 1);
+    }
+    block->storedSize = (storedSize > 0) ? storedSize : block->originalSize;
+}
+
+/* Returns the blockOriginal bytes held by the block whose blockStored stored
+ * bytes are at data: data itself if the block was stored as it is, or else
+ * original, which they are decompressed into with decompressor.
+ * Returns NULL if the block is damaged. */
+static const char* codecDecodeBlock(const codec* decompressor,
+                                    const char* data,
+                                    unsigned int blockStored,
+                                    char* original,
+                                    unsigned int blockOriginal)
+{
+    if(blockStored == blockOriginal)
+    {
+        return data;
+    }
+    return (decompressor->decompress(data, blockStored, original,
+                                     blockOriginal) < 0) ? NULL : original;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+const codec* codecFind(unsigned char id)
+{
+    for(unsigned int i = 0; i < NUM_CODECS; i++)
+    {
+        if(codecs[i].id == id)
+        {
+            return &(codecs[i]);
+        }
+    }
+    return NULL;
+}
+
+int codecCompressFile(const codec* compressor,
+                      threadPool* pool,
+                      FILE* src,
+                      FILE* dst,
+                      uint64_t size,
+                      uint64_t* storedSize,
+                      uint32_t* checksum)
+{
+    *storedSize = 0;
+    if(size == 0)
+    {
+        return COPY_SUCCESS;
+    }
+
+    unsigned int blockSize = (size < CODEC_BLOCK_SIZE) ? size
+                                                       : CODEC_BLOCK_SIZE;
+    unsigned int maxBlocks = pool ? pool->numThreads * BLOCKS_PER_THREAD : 1;
+    uint64_t numBlocksLeft = (size + CODEC_BLOCK_SIZE - 1) /
+                                 CODEC_BLOCK_SIZE;
+    if(maxBlocks > numBlocksLeft)
+    {
+        maxBlocks = numBlocksLeft;
+    }
+
+    codecBlock* blocks = malloc(sizeof(codecBlock) * maxBlocks);
+    char* buffers = malloc((size_t)blockSize * 2 * maxBlocks);
+    int result = COPY_SUCCESS;
+
+    if(!blocks || !buffers)
+    {
+        free(blocks);
+        free(buffers);
+        return COPY_WRITE_ERROR;
+    }
+
+    for(unsigned int i = 0; i < maxBlocks; i++)
+    {
+        blocks[i].compressor = compressor;
+        blocks[i].original = &(buffers[(size_t)blockSize * 2 * i]);
+        blocks[i].stored = &(buffers[(size_t)blockSize * (2 * i + 1)]);
+    }
+
+    while(size > 0)
+    {
+        // read as many blocks as the threads can compress at once
+        unsigned int numBlocks = 0;
+        while(size > 0 && numBlocks < maxBlocks)
+        {
+            codecBlock* block = &(blocks[numBlocks]);
+            block->originalSize = (size < blockSize) ? size : blockSize;
+            if(fread(block->original, sizeof(char), block->originalSize,
+                     src) < block->originalSize)
+            {
+                free(blocks);
+                free(buffers);
+                return COPY_SHORT_READ;
+            }
+            if(checksum)
+            {
+                *checksum = crc32cUpdate(*checksum, block->original,
+                                         block->originalSize);
+            }
+            size -= block->originalSize;
+            numBlocks++;
+        }
+
+        if(pool && numBlocks > 1)
+        {
+            for(unsigned int i = 0; i < numBlocks; i++)
+            {
+                threadPoolSubmit(pool, codecCompressBlock, &(blocks[i]));
+            }
+            threadPoolWait(pool);
+        }
+        else
+        {
+            for(unsigned int i = 0; i < numBlocks; i++)
+            {
+                codecCompressBlock(&(blocks[i]));
+            }
+        }
+
+        // write the blocks in order; after a failure, keep consuming src
+        for(unsigned int i = 0; i < numBlocks && result == COPY_SUCCESS; i++)
+        {
+            codecBlock* block = &(blocks[i]);
+            char* data = (block->storedSize == block->originalSize) ?
+                         block->original : block->stored;
+
+            if(fwrite(&(block->originalSize), sizeof(unsigned int), 1,
+                      dst) < 1 ||
+               fwrite(&(block->storedSize), sizeof(unsigned int), 1,
+                      dst) < 1 ||
+               fwrite(data, sizeof(char), block->storedSize, dst) <
+                   block->storedSize)
+            {
+                result = COPY_WRITE_ERROR;
+            }
+            *storedSize += BLOCK_HEADER_SIZE + block->storedSize;
+        }
+    }
+
+    free(blocks);
+    free(buffers);
+    return result;
+}
+
+int codecDecompressRange(const codec* decompressor,
+                         const fileMap* src,
+                         uint64_t srcOffset,
+                         uint64_t storedSize,
+                         int dstFd,
+                         uint64_t originalSize,
+                         uint32_t* checksum)
+{
+    char* stored = malloc(CODEC_BLOCK_SIZE);
+    char* original = malloc(CODEC_BLOCK_SIZE);
+    off_t dstOffset = 0;
+    int result = COPY_SUCCESS;
+
+    if(!stored || !original)
+    {
+        free(stored);
+        free(original);
+        return COPY_WRITE_ERROR;
+    }
+
+    while(storedSize > 0 && result == COPY_SUCCESS)
+    {
+        char headerBytes[BLOCK_HEADER_SIZE];
+        const char* header = (storedSize < BLOCK_HEADER_SIZE) ? NULL :
+                             fileMapRead(src, headerBytes, BLOCK_HEADER_SIZE,
+                                         srcOffset);
+        if(!header)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+        srcOffset += BLOCK_HEADER_SIZE;
+        storedSize -= BLOCK_HEADER_SIZE;
+
+        unsigned int blockOriginal; // the block's original size
+        unsigned int blockStored; // the block's stored size
+        memcpy(&blockOriginal, header, sizeof(unsigned int));
+        memcpy(&blockStored, &(header[sizeof(unsigned int)]),
+               sizeof(unsigned int));
+
+        // stored blocks are used in place in a mapping
+        const char* data = NULL;
+        if(blockOriginal <= CODEC_BLOCK_SIZE &&
+           blockOriginal <= (off_t)originalSize - dstOffset &&
+           blockStored <= blockOriginal &&
+           blockStored <= storedSize)
+        {
+            data = fileMapRead(src, stored, blockStored, srcOffset);
+        }
+        if(!data)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+        srcOffset += blockStored;
+        storedSize -= blockStored;
+
+        data = codecDecodeBlock(decompressor, data, blockStored, original,
+                                blockOriginal);
+        if(!data)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        if(checksum)
+        {
+            *checksum = crc32cUpdate(*checksum, data, blockOriginal);
+        }
+        if(dstFd >= 0 && fileWriteAt(dstFd, data, blockOriginal, dstOffset) < 0)
+        {
+            result = COPY_WRITE_ERROR;
+        }
+        dstOffset += blockOriginal;
+    }
+
+    if(result == COPY_SUCCESS && dstOffset != originalSize)
+    {
+        result = COPY_SHORT_READ;
+    }
+
+    free(stored);
+    free(original);
+    return result;
+}
+
+int codecDecompressFile(const codec* decompressor,
+                        FILE* src,
+                        FILE* dst,
+                        uint64_t originalSize,
+                        uint64_t* storedSize,
+                        uint32_t* checksum)
+{
+    char* stored = malloc(CODEC_BLOCK_SIZE);
+    char* original = malloc(CODEC_BLOCK_SIZE);
+    char decode = dst || checksum; // unset if the blocks are only skipped
+    int result = COPY_SUCCESS;
+
+    *storedSize = 0;
+    if(!stored || !original)
+    {
+        free(stored);
+        free(original);
+        return COPY_WRITE_ERROR;
+    }
+
+    while(originalSize > 0)
+    {
+        unsigned int blockOriginal; // the block's original size
+        unsigned int blockStored; // the block's stored size
+
+        if(fread(&blockOriginal, sizeof(unsigned int), 1, src) < 1 ||
+           fread(&blockStored, sizeof(unsigned int), 1, src) < 1 ||
+           blockOriginal == 0 || blockOriginal > CODEC_BLOCK_SIZE ||
+           blockOriginal > originalSize || blockStored > blockOriginal ||
+           fread(stored, sizeof(char), blockStored, src) < blockStored)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+        *storedSize += BLOCK_HEADER_SIZE + blockStored;
+        originalSize -= blockOriginal;
+
+        if(!decode)
+        {
+            continue;
+        }
+
+        const char* data = codecDecodeBlock(decompressor, stored, blockStored,
+                                            original, blockOriginal);
+        if(!data)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        if(checksum)
+        {
+            *checksum = crc32cUpdate(*checksum, data, blockOriginal);
+        }
+
+        // after a failure, keep consuming src
+        if(dst && result == COPY_SUCCESS &&
+           fwrite(data, sizeof(char), blockOriginal, dst) < blockOriginal)
+        {
+            result = COPY_WRITE_ERROR;
+        }
+    }
+
+    free(stored);
+    free(original);
+    return result;
+}
+
+blockTable* blockTableNew()
+{
+    blockTable* table = malloc(sizeof(blockTable));
+
+    if(!table)
+    {
+        return NULL;
+    }
+
+    table->sizeBlocks = INIT_BLOCKTABLE_SIZE;
+    table->starts = malloc(sizeof(uint64_t) * table->sizeBlocks);
+    table->offsets = malloc(sizeof(uint64_t) * table->sizeBlocks);
+    table->numBlocks = 0;
+    if(!table->starts || !table->offsets)
+    {
+        blockTableDelete(table);
+        return NULL;
+    }
+    return table;
+}
+
+void blockTableDelete(blockTable* table)
+{
+    free(table->starts);
+    free(table->offsets);
+    free(table);
+}
+
+int blockTableAdd(blockTable* table, uint64_t start, uint64_t offset)
+{
+    if(table->numBlocks == table->sizeBlocks)
+    {
+        size_t newSize = table->sizeBlocks * BLOCKTABLE_GROWTH_FACTOR;
+        uint64_t* starts = realloc(table->starts, sizeof(uint64_t) * newSize);
+        if(!starts)
+        {
+            return -1;
+        }
+        table->starts = starts;
+
+        uint64_t* offsets = realloc(table->offsets,
+                                    sizeof(uint64_t) * newSize);
+        if(!offsets)
+        {
+            return -1;
+        }
+        table->offsets = offsets;
+        table->sizeBlocks = newSize;
+    }
+
+    table->starts[table->numBlocks] = start;
+    table->offsets[table->numBlocks] = offset;
+    table->numBlocks++;
+    return 0;
+}
+
+size_t blockTableFind(const blockTable* table, uint64_t position)
+{
+    // the last block that starts at or before position
+    size_t low = 0;
+    size_t high = table->numBlocks - 1;
+
+    while(low < high)
+    {
+        size_t middle = low + (high - low + 1) / 2;
+        if(table->starts[middle] <= position)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+int codecReadBlockTable(const fileMap* src,
+                        uint64_t srcOffset,
+                        uint64_t storedSize,
+                        uint64_t originalSize,
+                        blockTable** table)
+{
+    blockTable* blocks = blockTableNew();
+    uint64_t blockStart = 0; // the position in the file of the next block
+
+    if(!blocks)
+    {
+        return COPY_WRITE_ERROR;
+    }
+
+    while(blockStart < originalSize)
+    {
+        char headerBytes[BLOCK_HEADER_SIZE];
+        const char* header = (storedSize < BLOCK_HEADER_SIZE) ? NULL :
+                             fileMapRead(src, headerBytes, BLOCK_HEADER_SIZE,
+                                         srcOffset);
+        unsigned int blockOriginal; // the block's original size
+        unsigned int blockStored; // the block's stored size
+
+        if(!header)
+        {
+            blockTableDelete(blocks);
+            return COPY_SHORT_READ;
+        }
+        memcpy(&blockOriginal, header, sizeof(unsigned int));
+        memcpy(&blockStored, &(header[sizeof(unsigned int)]),
+               sizeof(unsigned int));
+
+        if(blockOriginal == 0 || blockOriginal > CODEC_BLOCK_SIZE ||
+           blockOriginal > originalSize - blockStart ||
+           blockStored > blockOriginal ||
+           blockStored > storedSize - BLOCK_HEADER_SIZE)
+        {
+            blockTableDelete(blocks);
+            return COPY_SHORT_READ;
+        }
+
+        if(blockTableAdd(blocks, blockStart, srcOffset) < 0)
+        {
+            blockTableDelete(blocks);
+            return COPY_WRITE_ERROR;
+        }
+        srcOffset += BLOCK_HEADER_SIZE + blockStored;
+        storedSize -= BLOCK_HEADER_SIZE + blockStored;
+        blockStart += blockOriginal;
+    }
+
+    *table = blocks;
+    return COPY_SUCCESS;
+}
+
+int codecReadAt(const codec* decompressor,
+                const fileMap* src,
+                const blockTable* table,
+                uint64_t offset,
+                char* dst,
+                size_t len)
+{
+    char* stored = malloc(CODEC_BLOCK_SIZE);
+    char* original = malloc(CODEC_BLOCK_SIZE);
+    size_t copied = 0; // the number of bytes copied to dst
+    int result = COPY_SUCCESS;
+
+    if(!stored || !original)
+    {
+        free(stored);
+        free(original);
+        return COPY_WRITE_ERROR;
+    }
+
+    // the blocks before the one holding offset aren't touched; the sizes in
+    // the headers were checked when table was read
+    for(size_t block = (len > 0) ? blockTableFind(table, offset) : 0;
+        copied < len; block++)
+    {
+        char headerBytes[BLOCK_HEADER_SIZE];
+        const char* header = (block >= table->numBlocks) ? NULL :
+                             fileMapRead(src, headerBytes, BLOCK_HEADER_SIZE,
+                                         table->offsets[block]);
+        if(!header)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        unsigned int blockOriginal; // the block's original size
+        unsigned int blockStored; // the block's stored size
+        memcpy(&blockOriginal, header, sizeof(unsigned int));
+        memcpy(&blockStored, &(header[sizeof(unsigned int)]),
+               sizeof(unsigned int));
+
+        const char* data = fileMapRead(src, stored, blockStored,
+                                       table->offsets[block] +
+                                       BLOCK_HEADER_SIZE);
+        if(data)
+        {
+            data = codecDecodeBlock(decompressor, data, blockStored,
+                                    original, blockOriginal);
+        }
+        if(!data)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        size_t from = offset + copied - table->starts[block];
+        size_t n = blockOriginal - from;
+        if(n > len - copied)
+        {
+            n = len - copied;
+        }
+        memcpy(dst + copied, data + from, n);
+        copied += n;
+    }
+
+    free(stored);
+    free(original);
+    return result;
+}
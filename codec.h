@@ -0,0 +1,149 @@
+/*
+ * File:   codec.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Compresses and decompresses the bodies of archive entries.
+ *
+ * A compressed body is split into blocks of up to CODEC_BLOCK_SIZE bytes of
+ * the original file, each compressed on its own so that blocks can be
+ * compressed in parallel. Each block is laid out as
+ *     unsigned int original size, unsigned int stored size, stored bytes
+ * where a block whose stored size equals its original size didn't shrink and
+ * is stored as it is.
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "threadPool.h"
+#include "fileMap.h"
+
+// ids of codecs, as stored in entry headers
+#define CODEC_NONE (0) // the body is the file as it is
+#define CODEC_LZ (1) // the blocks are compressed by lz.h
+#define CODEC_DEDUP (2) // chunk records as described in dedup.h; not in codecs
+
+// the most bytes of the original file in one block
+#define CODEC_BLOCK_SIZE (256 * 1024)
+
+typedef struct
+{
+    unsigned char id; // the CODEC_ id of the codec
+    const char* name; // the name of the codec
+
+    /* Compresses the len bytes at src into at most dstLen bytes at dst.
+     * Returns the compressed size, or 0 if it doesn't fit. */
+    size_t (*compress)(const char* src, size_t len, char* dst, size_t dstLen);
+
+    /* Decompresses the len bytes at src into exactly dstLen bytes at dst.
+     * Returns 0 on success, -1 if the data is damaged. */
+    int (*decompress)(const char* src, size_t len, char* dst, size_t dstLen);
+} codec;
+
+// where the blocks of a compressed body, or the chunks of a CODEC_DEDUP one,
+// are, so a read can go straight to the ones holding a range of the file
+typedef struct
+{
+    uint64_t* starts; // starts[i] is the position in the file of block i;
+                      // the starts only increase
+    uint64_t* offsets; // offsets[i] is the offset in the archive of the
+                       // header of block i, or of chunk i's literal record
+    size_t numBlocks; // the number of elements in starts and offsets
+    size_t sizeBlocks; // the malloc'd size of starts and offsets
+} blockTable;
+
+/* Returns the codec with the given CODEC_ id, or NULL if there's none or it's
+ * CODEC_NONE. */
+const codec* codecFind(unsigned char id);
+
+/* Compresses size bytes from the current position of src with compressor and
+ * writes them in blocks to the current position of dst, setting *storedSize
+ * to the number of bytes written. If pool isn't NULL, its threads compress
+ * several blocks at once; the pool must have nothing else queued. If checksum
+ * isn't NULL, the bytes read from src are checksummed into it. Returns
+ * COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR as fileCopy does. */
+int codecCompressFile(const codec* compressor,
+                      threadPool* pool,
+                      FILE* src,
+                      FILE* dst,
+                      uint64_t size,
+                      uint64_t* storedSize,
+                      uint32_t* checksum);
+
+/* Decompresses the storedSize-byte body at srcOffset in src with
+ * decompressor, writing the originalSize bytes it holds to the beginning of
+ * the file open as dstFd, or nowhere if dstFd is negative. Blocks are read
+ * straight from src's mapping if it has one, and stored blocks are written
+ * from there too. If checksum isn't NULL, the decompressed bytes are
+ * checksummed into it. Uses positional reads and writes only, so several
+ * threads may decompress from the same src at once. Returns COPY_SUCCESS,
+ * COPY_SHORT_READ if the body is damaged or cut short, or COPY_WRITE_ERROR. */
+int codecDecompressRange(const codec* decompressor,
+                         const fileMap* src,
+                         uint64_t srcOffset,
+                         uint64_t storedSize,
+                         int dstFd,
+                         uint64_t originalSize,
+                         uint32_t* checksum);
+
+/* Decompresses the blocks holding originalSize bytes of a file from the
+ * current position of src with decompressor, writing the bytes to the
+ * current position of dst, or nowhere if dst is NULL, and sets *storedSize
+ * to the number of bytes read from src. If checksum isn't NULL, the
+ * decompressed bytes are checksummed into it; if it and dst are both NULL,
+ * the blocks are only skipped. Reads src from front to back only, so it may
+ * be a pipe. Returns COPY_SUCCESS, COPY_SHORT_READ if the blocks are damaged
+ * or cut short, or COPY_WRITE_ERROR. */
+int codecDecompressFile(const codec* decompressor,
+                        FILE* src,
+                        FILE* dst,
+                        uint64_t originalSize,
+                        uint64_t* storedSize,
+                        uint32_t* checksum);
+
+// mallocs an empty blockTable and returns a pointer to it, or NULL
+blockTable* blockTableNew();
+
+// Frees a blockTable
+void blockTableDelete(blockTable* table);
+
+/* Adds a block or chunk that starts at start in the file and whose header or
+ * record is at offset in the archive to the end of table.
+ * Returns 0 on success, -1 if memory runs out. */
+int blockTableAdd(blockTable* table, uint64_t start, uint64_t offset);
+
+/* Returns the index in table of the block holding position in the file, found
+ * by binary search. table must not be empty. */
+size_t blockTableFind(const blockTable* table, uint64_t position);
+
+/* Reads the block headers of the storedSize-byte body at srcOffset in src,
+ * which holds originalSize bytes of a file, and sets *table to a malloc'd
+ * blockTable of them. Only the headers are read. Returns COPY_SUCCESS,
+ * COPY_SHORT_READ if the body is damaged or cut short, or COPY_WRITE_ERROR
+ * if memory runs out. */
+int codecReadBlockTable(const fileMap* src,
+                        uint64_t srcOffset,
+                        uint64_t storedSize,
+                        uint64_t originalSize,
+                        blockTable** table);
+
+/* Copies the len bytes at offset in a file compressed with decompressor, whose
+ * body in src has the blocks of table, to dst, decompressing only the blocks
+ * that hold them. offset + len must not be past the end of the file. Uses
+ * positional reads only, as codecDecompressRange does.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ if the body is damaged, or
+ * COPY_WRITE_ERROR if memory runs out. */
+int codecReadAt(const codec* decompressor,
+                const fileMap* src,
+                const blockTable* table,
+                uint64_t offset,
+                char* dst,
+                size_t len);
+
+#endif
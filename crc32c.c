@@ -0,0 +1,126 @@
+/*
+ * File:   crc32c.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Computes CRC-32C checksums in hardware where possible.
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "crc32c.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_SSE42_CRC
+#include <nmmintrin.h>
+#endif
+
+// the reversed Castagnoli polynomial
+#define CRC32C_POLYNOMIAL (0x82F63B78u)
+
+// table[k][b] is the checksum of byte b followed by k zero bytes, so that
+// eight bytes can be folded in at once
+static uint32_t table[8][256];
+
+// the function that checksums bytes, picked once for this CPU
+static uint32_t (*update)(uint32_t, const unsigned char*, size_t) = NULL;
+static pthread_once_t pickOnce = PTHREAD_ONCE_INIT;
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Checksums len bytes at data into crc, which is in its inverted form,
+ * eight bytes at a time through table */
+static uint32_t updateTable(uint32_t crc, const unsigned char* data, size_t len)
+{
+    while(len >= 8)
+    {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, data, sizeof(uint32_t));
+        memcpy(&high, data + 4, sizeof(uint32_t));
+        low ^= crc; // little-endian, like the machines Far runs on
+
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+              table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        data += 8;
+        len -= 8;
+    }
+
+    while(len > 0)
+    {
+        crc = table[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+        data++;
+        len--;
+    }
+    return crc;
+}
+
+#ifdef HAVE_SSE42_CRC
+/* Checksums len bytes at data into crc, which is in its inverted form, with
+ * the crc32 instruction */
+__attribute__((target("sse4.2")))
+static uint32_t updateSse42(uint32_t crc, const unsigned char* data, size_t len)
+{
+    uint64_t crc64 = crc;
+
+    while(len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(uint64_t));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        len -= 8;
+    }
+
+    crc = crc64;
+    while(len > 0)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        len--;
+    }
+    return crc;
+}
+#endif
+
+/* Fills in table and picks the fastest update for this CPU */
+static void pickUpdate()
+{
+    for(unsigned int b = 0; b < 256; b++)
+    {
+        uint32_t crc = b;
+        for(unsigned int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+        table[0][b] = crc;
+    }
+    for(unsigned int k = 1; k < 8; k++)
+    {
+        for(unsigned int b = 0; b < 256; b++)
+        {
+            uint32_t previous = table[k - 1][b];
+            table[k][b] = table[0][previous & 0xFF] ^ (previous >> 8);
+        }
+    }
+
+    update = updateTable;
+#ifdef HAVE_SSE42_CRC
+    if(__builtin_cpu_supports("sse4.2"))
+    {
+        update = updateSse42;
+    }
+#endif
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+uint32_t crc32cUpdate(uint32_t crc, const void* data, size_t len)
+{
+    pthread_once(&pickOnce, pickUpdate);
+    return ~update(~crc, data, len);
+}
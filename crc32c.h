@@ -0,0 +1,26 @@
+/*
+ * File:   crc32c.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Computes CRC-32C (Castagnoli) checksums, which Far stores for the contents
+ * of each file so that damage to an archive can be found. Uses the crc32
+ * instruction of SSE4.2 when the CPU has it, and a table otherwise.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the checksum of no bytes, which crc32cUpdate starts from
+#define CRC32C_INIT (0)
+
+/* Returns the checksum of the bytes checksummed into crc followed by the len
+ * bytes at data. Checksums of a whole file may be built up a piece at a time
+ * by starting from CRC32C_INIT. Safe to call from several threads at once. */
+uint32_t crc32cUpdate(uint32_t crc, const void* data, size_t len);
+
+#endif
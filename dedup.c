@@ -0,0 +1,597 @@
+/*
+ * File:   dedup.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Stores the bodies of entries as lists of shared chunks; the format is
+ * described in dedup.h.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "dedup.h"
+#include "fileCopy.h"
+#include "crc32c.h"
+
+// the size in bytes of the header of a literal record
+#define LITERAL_HEADER_SIZE (2 * sizeof(unsigned char) + \
+                             2 * sizeof(unsigned int))
+
+// the size in bytes of a reference record
+#define REFERENCE_SIZE (sizeof(unsigned char) + sizeof(uint64_t))
+
+// the number of bytes read from a file at once while cutting it into chunks
+#define DEDUP_READ_SIZE (1024 * 1024)
+
+static uint64_t gear[256]; // the random value each byte adds to the cut hash
+static char gearReady = 0; // set once gear is filled in
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Fills in gear with the same pseudo-random values every time, so that a file
+ * is always cut in the same places */
+static void fillGear()
+{
+    uint64_t state = 0x9E3779B97F4A7C15u;
+
+    for(unsigned int i = 0; i < 256; i++)
+    {
+        // splitmix64
+        uint64_t value = (state += 0x9E3779B97F4A7C15u);
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9u;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBu;
+        gear[i] = value ^ (value >> 31);
+    }
+    gearReady = 1;
+}
+
+/* Returns the length of the first chunk of the len bytes at data. A chunk ends
+ * where the top CHUNK_AVERAGE_BITS bits of a rolling hash of the bytes before
+ * it are all 0, as long as it's between CHUNK_MIN_SIZE and CHUNK_MAX_SIZE
+ * bytes long; the hash covers only the last 64 bytes, so the same content
+ * is cut in the same places wherever it appears. */
+static size_t chunkLength(const unsigned char* data, size_t len)
+{
+    uint64_t hash = 0;
+    size_t maxLen = (len < CHUNK_MAX_SIZE) ? len : CHUNK_MAX_SIZE;
+
+    if(len <= CHUNK_MIN_SIZE)
+    {
+        return len;
+    }
+
+    for(size_t i = 0; i < maxLen; i++)
+    {
+        hash = (hash << 1) + gear[data[i]];
+        if(i + 1 >= CHUNK_MIN_SIZE &&
+           (hash >> (64 - CHUNK_AVERAGE_BITS)) == 0)
+        {
+            return i + 1;
+        }
+    }
+    return maxLen;
+}
+
+/* Returns the 64-bit FNV-1a hash of the len bytes at data */
+static uint64_t hashChunk(const char* data, size_t len)
+{
+    uint64_t hash = 14695981039346656037u;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+/* Reads the chunk in the literal record at offset in archive, setting *data
+ * to its bytes and *len to its size. *data points into archive's mapping if
+ * the chunk is stored as it is there, or else into chunk, which has room for
+ * CHUNK_MAX_SIZE bytes. stored is a CHUNK_MAX_SIZE scratch buffer. The record
+ * must end by limit. If codecId isn't NULL, it's set to the codec the chunk
+ * was stored with, and if recordLen isn't NULL, it's set to the size of the
+ * record. If data is NULL, only the record's header is read, and chunk and
+ * stored may be NULL too.
+ * Returns 0 on success, -1 if the record is damaged. */
+static int readLiteral(const fileMap* archive, uint64_t offset, uint64_t limit,
+                       char* chunk, char* stored, const char** data,
+                       unsigned int* len, unsigned char* codecId,
+                       uint64_t* recordLen)
+{
+    char headerBytes[LITERAL_HEADER_SIZE];
+    const char* header = NULL;
+    unsigned int originalSize;
+    unsigned int storedSize;
+
+    if(offset <= limit && limit - offset >= LITERAL_HEADER_SIZE)
+    {
+        header = fileMapRead(archive, headerBytes, LITERAL_HEADER_SIZE,
+                             offset);
+    }
+    if(!header || header[0] != CHUNK_LITERAL)
+    {
+        return -1;
+    }
+    memcpy(&originalSize, &(header[2]), sizeof(unsigned int));
+    memcpy(&storedSize, &(header[2 + sizeof(unsigned int)]),
+           sizeof(unsigned int));
+
+    if(originalSize > CHUNK_MAX_SIZE || storedSize > originalSize ||
+       limit - offset - LITERAL_HEADER_SIZE < storedSize)
+    {
+        return -1;
+    }
+
+    unsigned char id = header[1];
+    *len = originalSize;
+    if(codecId) *codecId = id;
+    if(recordLen) *recordLen = LITERAL_HEADER_SIZE + storedSize;
+    if(!data)
+    {
+        return 0;
+    }
+
+    const codec* decompressor = codecFind(id);
+    if(id == CODEC_NONE)
+    {
+        if(storedSize != originalSize ||
+           !(*data = fileMapRead(archive, chunk, storedSize,
+                                 offset + LITERAL_HEADER_SIZE)))
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        const char* bytes = !decompressor ? NULL :
+                            fileMapRead(archive, stored, storedSize,
+                                        offset + LITERAL_HEADER_SIZE);
+        if(!bytes ||
+           decompressor->decompress(bytes, storedSize,
+                                    chunk, originalSize) < 0)
+        {
+            return -1;
+        }
+        *data = chunk;
+    }
+    return 0;
+}
+
+/* Writes a record for the len-byte chunk at data to the current position of
+ * archive, as described for dedupWriteFile, and adds its size to
+ * *storedSize. scratch is a 2 * CHUNK_MAX_SIZE buffer.
+ * Returns 0 on success, -1 if archive can't be written. */
+static int writeChunk(archiveIndex* index,
+                      const codec* compressor,
+                      const char* data,
+                      unsigned int len,
+                      FILE* archive,
+                      char* scratch,
+                      uint64_t* storedSize)
+{
+    uint64_t hash = hashChunk(data, len);
+    int found = archiveIndexFindChunk(index, hash);
+
+    // refer to an equal chunk, after making sure it's not a hash collision
+    if(found >= 0)
+    {
+        uint64_t chunkOffset = index->chunks[found].offset;
+        off_t position = ftello(archive);
+        fileMap reader = {fileno(archive), NULL, 0}; // archive is growing
+        const char* foundData;
+        unsigned int foundLen;
+
+        if(fflush(archive) != EOF && position >= 0 &&
+           readLiteral(&reader, chunkOffset, position,
+                       scratch, &(scratch[CHUNK_MAX_SIZE]), &foundData,
+                       &foundLen, NULL, NULL) == 0 &&
+           foundLen == len && memcmp(foundData, data, len) == 0)
+        {
+            unsigned char kind = CHUNK_REFERENCE;
+            if(fwrite(&kind, sizeof(unsigned char), 1, archive) < 1 ||
+               fwrite(&chunkOffset, sizeof(uint64_t), 1, archive) < 1)
+            {
+                return -1;
+            }
+            *storedSize += REFERENCE_SIZE;
+            return 0;
+        }
+    }
+
+    // store the chunk itself, compressed if that makes it smaller
+    unsigned char kind = CHUNK_LITERAL;
+    unsigned char id = CODEC_NONE;
+    const char* stored = data;
+    unsigned int chunkStoredSize = len;
+
+    if(compressor && len > 1)
+    {
+        size_t compressedSize = compressor->compress(data, len, scratch,
+                                                     len - 1);
+        if(compressedSize > 0)
+        {
+            id = compressor->id;
+            stored = scratch;
+            chunkStoredSize = compressedSize;
+        }
+    }
+
+    off_t recordOffset = ftello(archive);
+    if(recordOffset < 0 ||
+       fwrite(&kind, sizeof(unsigned char), 1, archive) < 1 ||
+       fwrite(&id, sizeof(unsigned char), 1, archive) < 1 ||
+       fwrite(&len, sizeof(unsigned int), 1, archive) < 1 ||
+       fwrite(&chunkStoredSize, sizeof(unsigned int), 1, archive) < 1 ||
+       fwrite(stored, sizeof(char), chunkStoredSize, archive) <
+           chunkStoredSize)
+    {
+        return -1;
+    }
+
+    // a colliding chunk isn't added, so lookups keep finding the first
+    if(found < 0)
+    {
+        archiveIndexAddChunk(index, hash, recordOffset);
+    }
+    *storedSize += LITERAL_HEADER_SIZE + chunkStoredSize;
+    return 0;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+int dedupWriteFile(archiveIndex* index,
+                   const codec* compressor,
+                   FILE* src,
+                   FILE* archive,
+                   uint64_t size,
+                   uint64_t* storedSize,
+                   uint32_t* checksum)
+{
+    size_t bufferSize = DEDUP_READ_SIZE + CHUNK_MAX_SIZE;
+    char* buffer = malloc(bufferSize);
+    char* scratch = malloc(2 * CHUNK_MAX_SIZE);
+    size_t start = 0; // the first byte in buffer not yet in a chunk
+    size_t end = 0; // the end of the bytes read into buffer
+    unsigned int numChunks = index->numChunks;
+    int result = COPY_SUCCESS;
+
+    *storedSize = 0;
+    if(!buffer || !scratch)
+    {
+        free(buffer);
+        free(scratch);
+        return COPY_WRITE_ERROR;
+    }
+    if(!gearReady)
+    {
+        fillGear();
+    }
+
+    while(size > 0 || start < end)
+    {
+        // keep at least a whole chunk in buffer while src has more
+        if(end - start < CHUNK_MAX_SIZE && size > 0)
+        {
+            memmove(buffer, &(buffer[start]), end - start);
+            end -= start;
+            start = 0;
+
+            size_t readSize = bufferSize - end;
+            if(readSize > size)
+            {
+                readSize = size;
+            }
+            if(fread(&(buffer[end]), sizeof(char), readSize, src) < readSize)
+            {
+                result = COPY_SHORT_READ;
+                break;
+            }
+            if(checksum)
+            {
+                *checksum = crc32cUpdate(*checksum, &(buffer[end]), readSize);
+            }
+            end += readSize;
+            size -= readSize;
+        }
+
+        size_t len = chunkLength((unsigned char*)&(buffer[start]),
+                                 end - start);
+
+        // after a failure, keep consuming src
+        if(result == COPY_SUCCESS &&
+           writeChunk(index, compressor, &(buffer[start]), len, archive,
+                      scratch, storedSize) < 0)
+        {
+            result = COPY_WRITE_ERROR;
+        }
+        start += len;
+    }
+
+    // the chunks written for a file that failed are thrown away with it
+    if(result != COPY_SUCCESS)
+    {
+        archiveIndexTruncateChunks(index, numChunks);
+    }
+
+    free(buffer);
+    free(scratch);
+    return result;
+}
+
+int dedupCopyEntry(int oldFd,
+                   uint64_t oldDataEnd,
+                   archiveEntry* entry,
+                   archiveIndex* index,
+                   FILE* archive,
+                   uint64_t* storedSize)
+{
+    char* chunk = malloc(CHUNK_MAX_SIZE);
+    char* scratch = malloc(2 * CHUNK_MAX_SIZE);
+    uint64_t position = entry->offset; // the next record in the old body
+    uint64_t bodyEnd = entry->offset + entry->size;
+    fileMap old = {oldFd, NULL, 0};
+    int result = COPY_SUCCESS;
+
+    *storedSize = 0;
+    if(!chunk || !scratch)
+    {
+        free(chunk);
+        free(scratch);
+        return COPY_WRITE_ERROR;
+    }
+
+    while(position < bodyEnd && result == COPY_SUCCESS)
+    {
+        unsigned char kind;
+        unsigned char id;
+        const char* data;
+        unsigned int len;
+        uint64_t recordLen;
+        uint64_t literalOffset = position;
+
+        if(fileReadAt(oldFd, (char*)&kind, 1, position) < 0)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        // a reference is copied as the chunk it refers to
+        if(kind == CHUNK_REFERENCE)
+        {
+            if(bodyEnd - position < REFERENCE_SIZE ||
+               fileReadAt(oldFd, (char*)&literalOffset, sizeof(uint64_t),
+                          position + 1) < 0)
+            {
+                result = COPY_SHORT_READ;
+                break;
+            }
+        }
+
+        if(readLiteral(&old, literalOffset,
+                       (kind == CHUNK_REFERENCE) ? oldDataEnd : bodyEnd,
+                       chunk, scratch, &data, &len, &id, &recordLen) < 0)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+        position += (kind == CHUNK_REFERENCE) ? REFERENCE_SIZE : recordLen;
+
+        if(writeChunk(index, codecFind(id), data, len, archive, scratch,
+                      storedSize) < 0)
+        {
+            result = COPY_WRITE_ERROR;
+        }
+    }
+
+    free(chunk);
+    free(scratch);
+    return result;
+}
+
+int dedupExtractRange(const fileMap* archive,
+                      uint64_t dataEnd,
+                      archiveEntry* entry,
+                      int dstFd,
+                      uint32_t* checksum)
+{
+    char* chunk = malloc(CHUNK_MAX_SIZE);
+    char* scratch = malloc(CHUNK_MAX_SIZE);
+    uint64_t position = entry->offset; // the next record in the body
+    uint64_t bodyEnd = entry->offset + entry->size;
+    uint64_t written = 0; // the number of bytes written to dstFd
+    int result = COPY_SUCCESS;
+
+    if(!chunk || !scratch)
+    {
+        free(chunk);
+        free(scratch);
+        return COPY_WRITE_ERROR;
+    }
+
+    while(position < bodyEnd && result == COPY_SUCCESS)
+    {
+        char recordBytes[REFERENCE_SIZE];
+        const char* record = fileMapRead(archive, recordBytes, 1, position);
+        const char* data;
+        unsigned int len;
+        uint64_t recordLen;
+        uint64_t literalOffset = position;
+
+        if(!record)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        unsigned char kind = record[0];
+        if(kind == CHUNK_REFERENCE)
+        {
+            if(bodyEnd - position < REFERENCE_SIZE ||
+               !(record = fileMapRead(archive, recordBytes, REFERENCE_SIZE,
+                                      position)))
+            {
+                result = COPY_SHORT_READ;
+                break;
+            }
+            memcpy(&literalOffset, &(record[1]), sizeof(uint64_t));
+        }
+
+        if(readLiteral(archive, literalOffset,
+                       (kind == CHUNK_REFERENCE) ? dataEnd : bodyEnd,
+                       chunk, scratch, &data, &len, NULL, &recordLen) < 0 ||
+           len > entry->originalSize - written)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+        position += (kind == CHUNK_REFERENCE) ? REFERENCE_SIZE : recordLen;
+
+        if(checksum)
+        {
+            *checksum = crc32cUpdate(*checksum, data, len);
+        }
+        if(dstFd >= 0 && fileWriteAt(dstFd, data, len, written) < 0)
+        {
+            result = COPY_WRITE_ERROR;
+        }
+        written += len;
+    }
+
+    if(result == COPY_SUCCESS && written != entry->originalSize)
+    {
+        result = COPY_SHORT_READ;
+    }
+
+    free(chunk);
+    free(scratch);
+    return result;
+}
+
+int dedupReadChunkTable(const fileMap* archive,
+                        uint64_t dataEnd,
+                        archiveEntry* entry,
+                        blockTable** table)
+{
+    blockTable* chunks = blockTableNew();
+    uint64_t position = entry->offset; // the next record in the body
+    uint64_t bodyEnd = entry->offset + entry->size;
+    uint64_t chunkStart = 0; // the position in the file of the next chunk
+
+    if(!chunks)
+    {
+        return COPY_WRITE_ERROR;
+    }
+
+    while(position < bodyEnd)
+    {
+        char recordBytes[REFERENCE_SIZE];
+        const char* record = fileMapRead(archive, recordBytes, 1, position);
+        unsigned int chunkLen;
+        uint64_t recordLen;
+        uint64_t literalOffset = position;
+
+        if(!record)
+        {
+            blockTableDelete(chunks);
+            return COPY_SHORT_READ;
+        }
+
+        unsigned char kind = record[0];
+        if(kind == CHUNK_REFERENCE)
+        {
+            if(bodyEnd - position < REFERENCE_SIZE ||
+               !(record = fileMapRead(archive, recordBytes, REFERENCE_SIZE,
+                                      position)))
+            {
+                blockTableDelete(chunks);
+                return COPY_SHORT_READ;
+            }
+            memcpy(&literalOffset, &(record[1]), sizeof(uint64_t));
+        }
+
+        if(readLiteral(archive, literalOffset,
+                       (kind == CHUNK_REFERENCE) ? dataEnd : bodyEnd,
+                       NULL, NULL, NULL, &chunkLen, NULL, &recordLen) < 0 ||
+           chunkLen > entry->originalSize - chunkStart)
+        {
+            blockTableDelete(chunks);
+            return COPY_SHORT_READ;
+        }
+        position += (kind == CHUNK_REFERENCE) ? REFERENCE_SIZE : recordLen;
+
+        // empty chunks hold nothing to read
+        if(chunkLen > 0 && blockTableAdd(chunks, chunkStart, literalOffset) < 0)
+        {
+            blockTableDelete(chunks);
+            return COPY_WRITE_ERROR;
+        }
+        chunkStart += chunkLen;
+    }
+
+    if(chunkStart != entry->originalSize)
+    {
+        blockTableDelete(chunks);
+        return COPY_SHORT_READ;
+    }
+
+    *table = chunks;
+    return COPY_SUCCESS;
+}
+
+int dedupReadAt(const fileMap* archive,
+                uint64_t dataEnd,
+                const blockTable* table,
+                uint64_t offset,
+                char* dst,
+                size_t len)
+{
+    char* chunk = malloc(CHUNK_MAX_SIZE);
+    char* scratch = malloc(CHUNK_MAX_SIZE);
+    size_t copied = 0; // the number of bytes copied to dst
+    int result = COPY_SUCCESS;
+
+    if(!chunk || !scratch)
+    {
+        free(chunk);
+        free(scratch);
+        return COPY_WRITE_ERROR;
+    }
+
+    // the chunks before the one holding offset aren't touched
+    for(size_t i = (len > 0) ? blockTableFind(table, offset) : 0;
+        copied < len; i++)
+    {
+        const char* data;
+        unsigned int chunkLen;
+
+        if(i >= table->numBlocks ||
+           readLiteral(archive, table->offsets[i], dataEnd, chunk, scratch,
+                       &data, &chunkLen, NULL, NULL) < 0)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        size_t from = offset + copied - table->starts[i];
+        size_t n = chunkLen - from;
+        if(n > len - copied)
+        {
+            n = len - copied;
+        }
+        memcpy(dst + copied, data + from, n);
+        copied += n;
+    }
+
+    free(chunk);
+    free(scratch);
+    return result;
+}
@@ -0,0 +1,106 @@
+/*
+ * File:   dedup.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Stores the bodies of entries as lists of chunks, each of which is kept in
+ * the archive only once.
+ *
+ * Files are cut into chunks where a rolling hash of their contents says to,
+ * so that an insertion only changes the chunks around it. The body of an
+ * entry whose codec is CODEC_DEDUP is a series of chunk records, each one of
+ *     literal:   an unsigned char CHUNK_LITERAL, an unsigned char CODEC_ id,
+ *                an unsigned int original size, an unsigned int stored size,
+ *                and the chunk's bytes as stored with the codec
+ *     reference: an unsigned char CHUNK_REFERENCE and the uint64_t offset in
+ *                the archive of a literal record holding the chunk
+ * The chunk table in the archive's index maps the hash of each literal's
+ * original bytes to its offset, so later additions can refer to it.
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "archive.h"
+#include "codec.h"
+#include "fileMap.h"
+
+// kinds of chunk record
+#define CHUNK_LITERAL (0)
+#define CHUNK_REFERENCE (1)
+
+#define CHUNK_MIN_SIZE (2 * 1024) // chunks are cut no sooner than this
+#define CHUNK_AVERAGE_BITS (13) // the log2 of the average chunk size
+#define CHUNK_MAX_SIZE (64 * 1024) // chunks are cut no later than this
+
+/* Cuts size bytes from the current position of src into chunks and writes
+ * their records to the current position of archive, setting *storedSize to
+ * the number of bytes written. A chunk already in index's chunk table is
+ * written as a reference once its bytes are checked against the stored
+ * chunk; any other is written as a literal, compressed with compressor if
+ * it's not NULL and that makes it smaller, and added to the chunk table.
+ * On failure, the chunks added by this call are removed from index. If
+ * checksum isn't NULL, the bytes read from src are checksummed into it.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR. */
+int dedupWriteFile(archiveIndex* index,
+                   const codec* compressor,
+                   FILE* src,
+                   FILE* archive,
+                   uint64_t size,
+                   uint64_t* storedSize,
+                   uint32_t* checksum);
+
+/* Writes the chunks of entry, whose body is in the archive open as oldFd with
+ * bodies ending at oldDataEnd, to the current position of archive as
+ * dedupWriteFile would, so that entry's references point into archive.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ if entry's body is damaged, or
+ * COPY_WRITE_ERROR. */
+int dedupCopyEntry(int oldFd,
+                   uint64_t oldDataEnd,
+                   archiveEntry* entry,
+                   archiveIndex* index,
+                   FILE* archive,
+                   uint64_t* storedSize);
+
+/* Writes the file held by entry, whose body is in archive with bodies ending
+ * at dataEnd, to the beginning of the file open as dstFd, or nowhere if dstFd
+ * is negative. Chunks stored as they are are written straight from archive's
+ * mapping if it has one. If checksum isn't NULL, the file's bytes are
+ * checksummed into it. Uses positional reads and writes only, so several
+ * threads may extract from the same archive at once.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ if the body is damaged, or
+ * COPY_WRITE_ERROR. */
+int dedupExtractRange(const fileMap* archive,
+                      uint64_t dataEnd,
+                      archiveEntry* entry,
+                      int dstFd,
+                      uint32_t* checksum);
+
+/* Reads the chunk records of entry, whose body is in archive with bodies
+ * ending at dataEnd, and sets *table to a malloc'd blockTable of its chunks,
+ * with references already followed to their literals. Only the records and
+ * the literals' headers are read.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ if the body is damaged, or
+ * COPY_WRITE_ERROR if memory runs out. */
+int dedupReadChunkTable(const fileMap* archive,
+                        uint64_t dataEnd,
+                        archiveEntry* entry,
+                        blockTable** table);
+
+/* Copies the len bytes at offset in a file whose body is in archive, with
+ * bodies ending at dataEnd, and has the chunks of table, to dst, reassembling
+ * only the chunks that hold them. offset + len must not be past the end of
+ * the file. Uses positional reads only, as dedupExtractRange does.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ if the body is damaged, or
+ * COPY_WRITE_ERROR if memory runs out. */
+int dedupReadAt(const fileMap* archive,
+                uint64_t dataEnd,
+                const blockTable* table,
+                uint64_t offset,
+                char* dst,
+                size_t len);
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * File:   dirCache.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Remembers the directories created or found during one extraction.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "dirCache.h"
+
+#define INIT_DIRCACHE_SLOTS (64)
+
+// the percentage of slots in use at which the table is made bigger
+#define DIRCACHE_MAX_LOAD_PERCENT (50)
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Returns the 32-bit FNV-1a hash of the first len chars of path */
+static unsigned int dirCacheHash(const char* path, unsigned int len)
+{
+    unsigned int hash = 2166136261u;
+
+    for(unsigned int i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Returns the slot in slots (of numSlots slots) that holds the first len
+ * chars of path, or the empty slot where they would go. */
+static unsigned int dirCacheFindSlot(dirCacheEntry* slots,
+                                     unsigned int numSlots,
+                                     const char* path,
+                                     unsigned int len)
+{
+    unsigned int mask = numSlots - 1;
+    unsigned int slot = dirCacheHash(path, len) & mask;
+
+    // linear probing; the table is never full, so this ends
+    while(slots[slot].path != NULL &&
+          (slots[slot].pathLen != len ||
+           memcmp(slots[slot].path, path, len) != 0))
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Doubles the number of slots in cache */
+static void dirCacheGrow(dirCache* cache)
+{
+    unsigned int newNumSlots = cache->numSlots * 2;
+    dirCacheEntry* newSlots = calloc(newNumSlots, sizeof(dirCacheEntry));
+
+    for(unsigned int i = 0; i < cache->numSlots; i++)
+    {
+        dirCacheEntry* entry = &(cache->slots[i]);
+        if(entry->path)
+        {
+            newSlots[dirCacheFindSlot(newSlots, newNumSlots,
+                                      entry->path, entry->pathLen)] = *entry;
+        }
+    }
+
+    free(cache->slots);
+    cache->slots = newSlots;
+    cache->numSlots = newNumSlots;
+}
+
+/* Sets *dirFd to the handle of the directory named by the first pathLen chars
+ * of path, or to AT_FDCWD if cache holds none, if cache has the directory.
+ * Returns 0 if it does, -1 if it doesn't. Only reads the table, so any
+ * number of threads can look up at once. */
+static int dirCacheLookup(dirCache* cache,
+                          const char* path,
+                          unsigned int pathLen,
+                          int* dirFd)
+{
+    int result = -1;
+
+    pthread_rwlock_rdlock(&(cache->lock));
+    dirCacheEntry* entry = &(cache->slots[
+        dirCacheFindSlot(cache->slots, cache->numSlots, path, pathLen)]);
+    if(entry->path)
+    {
+        *dirFd = (entry->fd >= 0) ? entry->fd : AT_FDCWD;
+        result = 0;
+    }
+    pthread_rwlock_unlock(&(cache->lock));
+
+    return result;
+}
+
+/* Adds the directory named by the first pathLen chars of path, which was
+ * just created or found, to cache with the handle fd, or -1 if there's none.
+ * If another thread added it first, fd is closed and that thread's handle is
+ * used. Returns the handle kept for the directory, or AT_FDCWD if none is. */
+static int dirCacheInsert(dirCache* cache,
+                          const char* path,
+                          unsigned int pathLen,
+                          int fd)
+{
+    pthread_rwlock_wrlock(&(cache->lock));
+
+    dirCacheEntry* entry = &(cache->slots[
+        dirCacheFindSlot(cache->slots, cache->numSlots, path, pathLen)]);
+    if(entry->path)
+    {
+        if(fd >= 0) close(fd);
+        fd = entry->fd;
+    }
+    else
+    {
+        // keep the handle only while there's room; the directory is
+        // remembered either way
+        if(fd >= 0 && cache->numHandles >= DIRCACHE_MAX_HANDLES)
+        {
+            close(fd);
+            fd = -1;
+        }
+        else if(fd >= 0)
+        {
+            cache->numHandles++;
+        }
+
+        if((cache->numEntries + 1) * 100 >
+           cache->numSlots * DIRCACHE_MAX_LOAD_PERCENT)
+        {
+            dirCacheGrow(cache);
+        }
+
+        entry = &(cache->slots[
+            dirCacheFindSlot(cache->slots, cache->numSlots, path, pathLen)]);
+        entry->path = malloc(sizeof(char) * (pathLen + 1));
+        memcpy(entry->path, path, pathLen);
+        entry->path[pathLen] = '\0';
+        entry->pathLen = pathLen;
+        entry->fd = fd;
+        cache->numEntries++;
+    }
+
+    pthread_rwlock_unlock(&(cache->lock));
+    return (fd >= 0) ? fd : AT_FDCWD;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+dirCache* dirCacheNew()
+{
+    dirCache* cache = malloc(sizeof(dirCache));
+
+    if(!cache)
+    {
+        return NULL;
+    }
+
+    cache->slots = calloc(INIT_DIRCACHE_SLOTS, sizeof(dirCacheEntry));
+    if(!cache->slots)
+    {
+        free(cache);
+        return NULL;
+    }
+
+    cache->numSlots = INIT_DIRCACHE_SLOTS;
+    cache->numEntries = 0;
+    cache->numHandles = 0;
+    pthread_rwlock_init(&(cache->lock), NULL);
+    return cache;
+}
+
+void dirCacheDelete(dirCache* cache)
+{
+    for(unsigned int i = 0; i < cache->numSlots; i++)
+    {
+        if(cache->slots[i].path)
+        {
+            if(cache->slots[i].fd >= 0) close(cache->slots[i].fd);
+            free(cache->slots[i].path);
+        }
+    }
+
+    pthread_rwlock_destroy(&(cache->lock));
+    free(cache->slots);
+    free(cache);
+}
+
+int dirCacheEnsure(dirCache* cache,
+                   const char* path,
+                   unsigned int pathLen,
+                   int* dirFd)
+{
+    if(dirCacheLookup(cache, path, pathLen, dirFd) == 0)
+    {
+        return 0;
+    }
+
+    // the directory's name is the component between the previous slash and
+    // its own; its parent is everything before that
+    unsigned int nameStart = pathLen - 1;
+    while(nameStart > 0 && path[nameStart - 1] != '/')
+    {
+        nameStart--;
+    }
+
+    int parentFd = AT_FDCWD;
+    if(nameStart > 0 &&
+       dirCacheEnsure(cache, path, nameStart, &parentFd) < 0)
+    {
+        return -1;
+    }
+
+    // the directory is created without the lock; two threads that create
+    // the same one both find it exists, and the first to add it wins
+    int fd = -1;
+    if(nameStart == pathLen - 1 && nameStart > 0)
+    {
+        // an empty component, as in "a//"; the directory is its parent
+        if(parentFd != AT_FDCWD)
+        {
+            fd = dup(parentFd);
+        }
+    }
+    else
+    {
+        // without a handle to the parent, name the directory by its path
+        unsigned int nameOffset = (parentFd == AT_FDCWD) ? 0 : nameStart;
+        unsigned int nameLen = pathLen - nameOffset;
+        char* name = malloc(sizeof(char) * (nameLen + 1));
+
+        memcpy(name, &(path[nameOffset]), nameLen);
+        name[nameLen] = '\0';
+
+        if(mkdirat(parentFd, name, 0777) < 0 && errno != EEXIST)
+        {
+            free(name);
+            return -1;
+        }
+
+        fd = openat(parentFd, name, O_RDONLY | O_DIRECTORY);
+        free(name);
+        if(fd < 0)
+        {
+            return -1;
+        }
+    }
+
+    *dirFd = dirCacheInsert(cache, path, pathLen, fd);
+    return 0;
+}
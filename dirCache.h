@@ -0,0 +1,57 @@
+/*
+ * File:   dirCache.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Remembers the directories that have been created or found during one
+ * extraction, and holds handles to them so that files can be created
+ * relative to their directory without walking its path again. Safe to use
+ * from several threads at once.
+ */
+
+#ifndef DIRCACHE_H
+#define DIRCACHE_H
+
+#include <pthread.h>
+
+// the most directory handles a dirCache holds open at once
+#define DIRCACHE_MAX_HANDLES (256)
+
+typedef struct
+{
+    char* path; // the directory's path, ending in '/'; NULL for an empty slot
+    unsigned int pathLen; // the strlen of path
+    int fd; // a handle to the directory, or -1 if none is held
+} dirCacheEntry;
+
+typedef struct
+{
+    dirCacheEntry* slots; // the hash table of directories
+    unsigned int numSlots; // the number of slots, a power of 2
+    unsigned int numEntries; // the number of slots in use
+    unsigned int numHandles; // the number of entries whose fd is held
+    pthread_rwlock_t lock; // guards everything above; held for writing
+                           // only while a directory is added
+} dirCache;
+
+/* mallocs an empty dirCache and returns a pointer to it.
+ * Returns NULL upon failure. */
+dirCache* dirCacheNew();
+
+// Closes the handles held by cache and frees it
+void dirCacheDelete(dirCache* cache);
+
+/* Makes sure the directory named by the first pathLen chars of path, which
+ * end in '/', exists, along with every directory above it, creating those
+ * that don't. Only directories not already in cache cost any syscalls.
+ * On success, returns 0 and sets *dirFd to a handle of the directory, or to
+ * AT_FDCWD if cache holds no handle for it, in which case files in it must be
+ * named by their whole path. Returns -1 if a directory can't be created or
+ * opened. */
+int dirCacheEnsure(dirCache* cache,
+                   const char* path,
+                   unsigned int pathLen,
+                   int* dirFd);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * File:   dirTrie.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * A trie of the path components of directory names.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "dirTrie.h"
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Returns the 32-bit FNV-1a hash of the edge leaving node parent with the
+ * len-char component */
+static unsigned int hashEdge(unsigned int parent, const char* component,
+                             unsigned int len)
+{
+    unsigned int hash = 2166136261u;
+
+    for(unsigned int i = 0; i < sizeof(unsigned int); i++)
+    {
+        hash ^= (parent >> (8 * i)) & 0xFF;
+        hash *= 16777619u;
+    }
+    for(unsigned int i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)component[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Returns the slot in trie that holds the edge leaving node parent with the
+ * len-char component, or the empty slot where that edge would go. */
+static unsigned int findEdgeSlot(dirTrie* trie, unsigned int parent,
+                                 const char* component, unsigned int len)
+{
+    unsigned int mask = trie->numSlots - 1;
+    unsigned int slot = hashEdge(parent, component, len) & mask;
+
+    // linear probing; the table is never full, so this ends
+    while(trie->slots[slot] != 0)
+    {
+        dirTrieEdge* edge = &(trie->edges[trie->slots[slot] - 1]);
+        if(edge->parent == parent && edge->len == len &&
+           memcmp(edge->component, component, len) == 0)
+        {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Returns the length of the path component at the beginning of path,
+ * including its trailing '/', or 0 if path has no more '/'. */
+static unsigned int componentLength(const char* path)
+{
+    const char* slash = strchr(path, '/');
+    return slash ? (slash - path) + 1 : 0;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+dirTrie* dirTrieNew(char** dirnames, unsigned int numDirnames)
+{
+    dirTrie* trie = malloc(sizeof(dirTrie));
+    unsigned int maxEdges = 0; // one edge per component of every dirname
+
+    if(!trie)
+    {
+        return NULL;
+    }
+
+    for(unsigned int i = 0; i < numDirnames; i++)
+    {
+        for(const char* c = dirnames[i]; *c != '\0'; c++)
+        {
+            if(*c == '/') maxEdges++;
+        }
+    }
+
+    trie->numSlots = 1;
+    while(trie->numSlots < 2 * maxEdges)
+    {
+        trie->numSlots *= 2;
+    }
+
+    trie->edges = malloc(sizeof(dirTrieEdge) * (maxEdges + 1));
+    trie->slots = calloc(trie->numSlots, sizeof(unsigned int));
+    trie->dirIndices = malloc(sizeof(int) * (maxEdges + 1));
+    trie->numEdges = 0;
+    if(!trie->edges || !trie->slots || !trie->dirIndices)
+    {
+        dirTrieDelete(trie);
+        return NULL;
+    }
+    trie->dirIndices[0] = -1;
+
+    // add the components of each dirname, creating nodes as needed
+    for(unsigned int i = 0; i < numDirnames; i++)
+    {
+        unsigned int node = 0;
+        const char* component = dirnames[i];
+        unsigned int len;
+
+        while((len = componentLength(component)) > 0)
+        {
+            unsigned int slot = findEdgeSlot(trie, node, component, len);
+
+            if(trie->slots[slot] == 0)
+            {
+                dirTrieEdge* edge = &(trie->edges[trie->numEdges]);
+                edge->parent = node;
+                edge->child = trie->numEdges + 1;
+                edge->component = component;
+                edge->len = len;
+                trie->dirIndices[edge->child] = -1;
+                trie->numEdges++;
+                trie->slots[slot] = trie->numEdges;
+            }
+
+            node = trie->edges[trie->slots[slot] - 1].child;
+            component += len;
+        }
+
+        // only the first of any repeated dirnames is recorded
+        if(node != 0 && trie->dirIndices[node] < 0)
+        {
+            trie->dirIndices[node] = i;
+        }
+    }
+
+    return trie;
+}
+
+void dirTrieDelete(dirTrie* trie)
+{
+    free(trie->edges);
+    free(trie->slots);
+    free(trie->dirIndices);
+    free(trie);
+}
+
+int dirTrieMatch(dirTrie* trie, const char* filename)
+{
+    unsigned int node = 0;
+    int match = -1; // the lowest dirname index found so far
+    unsigned int len;
+
+    // follow the components of filename down the trie as far as they go
+    while(trie->numEdges > 0 && (len = componentLength(filename)) > 0)
+    {
+        unsigned int slot = findEdgeSlot(trie, node, filename, len);
+        if(trie->slots[slot] == 0)
+        {
+            break;
+        }
+
+        node = trie->edges[trie->slots[slot] - 1].child;
+        if(trie->dirIndices[node] >= 0 &&
+           (match < 0 || trie->dirIndices[node] < match))
+        {
+            match = trie->dirIndices[node];
+        }
+        filename += len;
+    }
+
+    return match;
+}
@@ -0,0 +1,49 @@
+/*
+ * File:   dirTrie.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * A trie of the path components of directory names, used to find which of
+ * many directory names is a prefix of a filename with a single walk of the
+ * filename.
+ */
+
+#ifndef DIRTRIE_H
+#define DIRTRIE_H
+
+typedef struct
+{
+    unsigned int parent; // the node that the edge leaves
+    unsigned int child; // the node that the edge enters
+    const char* component; // the path component labelling the edge, ending
+                           // in '/'; points into a directory name
+    unsigned int len; // the length of component, including the '/'
+} dirTrieEdge;
+
+typedef struct
+{
+    dirTrieEdge* edges; // the edges of the trie; node i+1 is entered by
+                        // edges[i], and node 0 is the root
+    unsigned int numEdges; // the number of elements in edges
+    unsigned int* slots; // hash table of 1 + indices into edges, keyed by
+                         // parent and component; 0 marks an empty slot
+    unsigned int numSlots; // the number of slots, a power of 2
+    int* dirIndices; // for each node, the lowest index of a directory name
+                     // that ends at it, or -1
+} dirTrie;
+
+/* mallocs a dirTrie of the numDirnames directory names in dirnames and
+ * returns a pointer to it. Each directory name must end in '/', and
+ * dirnames must outlive the dirTrie. Returns NULL upon failure. */
+dirTrie* dirTrieNew(char** dirnames, unsigned int numDirnames);
+
+// Frees a dirTrie, but not the directory names it was built from
+void dirTrieDelete(dirTrie* trie);
+
+/* Determines if the trie's directory names contain a prefix of filename.
+ * Returns the index of the first directory name that is a prefix, or -1 if
+ * there's no prefix. */
+int dirTrieMatch(dirTrie* trie, const char* filename);
+
+#endif
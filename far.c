@@ -7,6 +7,8 @@
  * Provides the implementation for Far
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,11 +17,51 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include "far.h"
 #include "charBuffer.h"
 #include "fileList.h"
+#include "fileCopy.h"
+#include "fileMap.h"
+#include "archive.h"
+#include "farArchive.h"
+#include "nameSet.h"
+#include "dirTrie.h"
+#include "threadPool.h"
+#include "dirCache.h"
+#include "codec.h"
+#include "dedup.h"
+#include "crc32c.h"
+
+// the most names tried for the link that publishes an anonymous temp archive
+#define MAX_TEMP_LINK_ATTEMPTS (100)
+
+// the name of an archive that is read from stdin or written to stdout
+#define STDIO_ARCHIVE_NAME "-"
+
+// the number of tasks queued for each thread in a pool before the thread
+// handing them out waits for the workers to catch up
+#define QUEUE_PER_THREAD (16)
+
+// files stored as they are up to this size are read whole before their
+// header is written, so that the checksum in it needn't be patched later
+#define SMALL_FILE_SIZE (64 * 1024)
+
+// when set, 'd' marks entries deleted in place instead of rewriting the archive
+static char lazyDelete = 0;
+
+// the number of threads that 'x' extracts files with and 'r' walks
+// directories with
+static unsigned int numThreads = 1;
+
+// the codec that 'r' compresses new files with, or NULL to store them as
+// they are
+static const codec* compressor = NULL;
 
-#define TEMP_ARCHIVE_NAME "ARCHIVE.bak"
+// when set, 'r' stores new files as chunks shared with the rest of the archive
+static char dedup = 0;
 
 /*******************************************************************************
 ********************************** Errors **************************************
@@ -27,7 +69,7 @@
 
 /* Called when the given archive name can't be opened. Prints a message to
  * stderr. Returns an error code. */
-FAR_RTRN invalidArchiveNameError()
+static FAR_RTRN invalidArchiveNameError()
 {
     fprintf(stderr, "Cannot open/create archive.\n");
     return OPEN_ERROR;
@@ -35,16 +77,24 @@ FAR_RTRN invalidArchiveNameError()
 
 /* Called when the archive file is of an unexpected format. Prints a message to
  * stderr. Returns an error code. */
-FAR_RTRN corruptedArchiveError()
+static FAR_RTRN corruptedArchiveError()
 {
     fprintf(stderr, "The archive is corrupted.\n");
     return CORRUPTED_ARCH;
 }
 
+/* Called when an archive with an index, which is read from the end, is
+ * piped to Far. Prints a message to stderr. Returns an error code. */
+static FAR_RTRN pipedArchiveError()
+{
+    fprintf(stderr, "Only streamed archives can be read from a pipe.\n");
+    return OPEN_ERROR;
+}
+
 /* Called when Far fails to open a non-archive file with fopen. Prints a
  * message to stderr. The argument filename is the name of the file that
  * failed to open. */
-void fileOpenError(const char* filename)
+static void fileOpenError(const char* filename)
 {
     fprintf(stderr, "Cannot open file: %s\n", filename);
 }
@@ -52,13 +102,14 @@ void fileOpenError(const char* filename)
 /* Called when Far fails to open/create a directory, likely due to lack of
  * permission. Prints a message to stderr. The argument is the name of the
  * directory. */
-void dirOpenError(const char* dirname)
+static void dirOpenError(const char* dirname)
 {
     fprintf(stderr, "Cannot open directory: %s\n", dirname);
 }
 
-/* Called when Far fails to create ARCHIVE.bak. Prints a message to stderr. */
-FAR_RTRN openTempArchiveError()
+/* Called when Far fails to create the temporary file that an archive is
+ * rewritten into. Prints a message to stderr. */
+static FAR_RTRN openTempArchiveError()
 {
     fprintf(stderr, "Failed to create temporary file.\n");
     return TEMP_FILE_ERROR;
@@ -66,98 +117,368 @@ FAR_RTRN openTempArchiveError()
 
 /* Called when a file argument passed to Far can't be found in the given archive
  * file. Prints a message to stderr. */
-void cannotFindArgError(const char* filename)
+static void cannotFindArgError(const char* filename)
 {
     fprintf(stderr, "Cannot find file: %s\n", filename);
 }
 
+/* Called when an archive can't be written in full. Prints a message to
+ * stderr. Returns an error code. */
+static FAR_RTRN archiveWriteError()
+{
+    fprintf(stderr, "Failed to write the archive.\n");
+    return WRITE_ERROR;
+}
+
+/* Called when the index of the archive open as archive, which was to be
+ * modified, can't be read. Prints a message to stderr: that the archive is
+ * streamed, since streamed archives have no index and can't be modified, or
+ * else that it's corrupted. Returns an error code. */
+static FAR_RTRN unmodifiableArchiveError(FILE* archive)
+{
+    archiveIndex* index = archiveIndexNew();
+    char streamed = fseeko(archive, 0, SEEK_SET) == 0 &&
+                    archiveStreamReadHeader(archive, index) == 0;
+    archiveIndexDelete(index);
+    
+    if(streamed)
+    {
+        fprintf(stderr, "Streamed archives can't be modified.\n");
+        return OPEN_ERROR;
+    }
+    return corruptedArchiveError();
+}
+
+/* Called when an entry can't be copied from one archive to another with the
+ * given return code of fileCopy. Prints a message to stderr. Returns an error
+ * code. */
+static FAR_RTRN copyEntryError(int copyResult)
+{
+    return (copyResult == COPY_WRITE_ERROR) ? archiveWriteError()
+                                            : corruptedArchiveError();
+}
+
+/* Called when a streamed archive can't be written in full. Prints a message
+ * to stderr. Returns an error code. */
+static FAR_RTRN streamWriteError()
+{
+    fprintf(stderr, "Failed to write the archive; it is incomplete.\n");
+    return WRITE_ERROR;
+}
+
 
 /*******************************************************************************
 ***************************** Helper Functions *********************************
 *******************************************************************************/
 
-/* Copies a nul-terminated string starting at the current file position in
- * archive into the charBuffer named filename. Returns 0 if successful,
- * 1 if failed. */
-int getFileName(FILE* archive, charBuffer* filename)
+/* Gives the file open as fd the permissions of oldArchive, or those that a
+ * new file would get if oldArchive is NULL */
+static void setTempArchiveMode(int fd, FILE* oldArchive)
+{
+    struct stat oldStat;
+    
+    if(oldArchive && fstat(fileno(oldArchive), &oldStat) == 0)
+    {
+        fchmod(fd, oldStat.st_mode & 07777);
+    }
+    else
+    {
+        mode_t mask = umask(0);
+        umask(mask);
+        fchmod(fd, 0666 & ~mask);
+    }
+}
+
+/* Creates the temporary file that the archive named archiveName is rewritten
+ * into and opens it for reading and writing. It's made in the archive's own
+ * directory, so that it can replace the archive with a rename, and so that
+ * Far runs on different archives never share one. Where the filesystem
+ * supports it, it's an anonymous O_TMPFILE that disappears if Far stops
+ * before finalizeArchive, and *tempName is set to NULL; otherwise it has a
+ * unique name next to the archive, and *tempName is set to a malloc'd copy of
+ * it. The file gets the permissions of oldArchive if it isn't NULL.
+ * Returns NULL on failure. */
+static FILE* openTempArchive(char* archiveName,
+                             FILE* oldArchive,
+                             char** tempName)
 {
-    charBufferClear(filename);
+    int fd = -1;
+    *tempName = NULL;
+    
+#ifdef O_TMPFILE
+    // an anonymous file is published through /proc, so it must be there
+    if(access("/proc/self/fd", X_OK) == 0)
+    {
+        char* lastSlash = strrchr(archiveName, '/');
+        char* dirName = malloc(strlen(archiveName) + 2);
+        if(!lastSlash)
+        {
+            strcpy(dirName, ".");
+        }
+        else
+        {
+            // the root directory keeps its slash
+            size_t dirLen = (lastSlash == archiveName) ? 1
+                                                       : lastSlash - archiveName;
+            strncpy(dirName, archiveName, dirLen);
+            dirName[dirLen] = '\0';
+        }
+        fd = open(dirName, O_TMPFILE | O_RDWR, 0666);
+        free(dirName);
+    }
+#endif
     
-    int c;
-    while((c = getc(archive)) != '\0')
+    if(fd < 0)
     {
-        if(c == EOF)
+        *tempName = malloc(strlen(archiveName) + sizeof(".XXXXXX"));
+        sprintf(*tempName, "%s.XXXXXX", archiveName);
+        fd = mkstemp(*tempName);
+        if(fd < 0)
         {
-            return 1; // failure
+            free(*tempName);
+            *tempName = NULL;
+            return NULL;
         }
-        charBufferAppend(filename, c);
     }
-    charBufferAppend(filename, c); // add final \0 to charBuffer
+    setTempArchiveMode(fd, oldArchive);
     
-    return 0; // success
+    FILE* tempArchive = fdopen(fd, "wb+");
+    if(!tempArchive)
+    {
+        close(fd);
+        if(*tempName)
+        {
+            unlink(*tempName);
+            free(*tempName);
+            *tempName = NULL;
+        }
+    }
+    return tempArchive;
 }
 
-/* Determines if name is in nameArray (which has length numNames). Returns the
- * index of the first match in nameArray, or returns -1 if there is no match */
-int isDuplicateFile(char* name, char** nameArray, unsigned int numNames)
+/* Closes tempArchive, opened by openTempArchive with the name tempName,
+ * without publishing it, and deletes it */
+static void discardTempArchive(FILE* tempArchive, char* tempName)
 {
-    for(unsigned int i = 0; i < numNames; i++)
+    fclose(tempArchive);
+    if(tempName)
     {
-        if(strcmp(name, nameArray[i]) == 0)
-        {
-            return i;
-        }
+        unlink(tempName);
+        free(tempName);
     }
-    return -1;
 }
 
-/* Determines if dirnames (which contains numDirnames elements) contains a
- * prefix for filename. Returns the index of the first element of dirnames that
- * is a prefix, or -1 if there's no prefix. */
-int isDirectoryMatch(char* filename, char** dirnames, unsigned int numDirnames)
+/* Gives the anonymous temp archive tempArchive the name archiveName,
+ * replacing the file with that name. A file can only be linked to a name
+ * that's free, so it's linked to a unique name next to archiveName first and
+ * then renamed. Returns 0 on success, -1 on failure. */
+static int publishAnonymousArchive(FILE* tempArchive, char* archiveName)
 {
-    char* substringPtr;
+    char procName[sizeof("/proc/self/fd/") + 3 * sizeof(int)];
+    char* linkName = malloc(strlen(archiveName) + 3 * sizeof(long) + 16);
+    int result = -1;
     
-    for(unsigned int i = 0; i < numDirnames; i++)
+    sprintf(procName, "/proc/self/fd/%d", fileno(tempArchive));
+    for(unsigned int i = 0; i < MAX_TEMP_LINK_ATTEMPTS; i++)
     {
-        substringPtr = strstr(filename, dirnames[i]);
-        
-        // see if substringPtr points to the beginning of filename, in which
-        // case dirnames[i] is a prefix
-        if(substringPtr == filename)
+        sprintf(linkName, "%s.%ld.%u", archiveName, (long)getpid(), i);
+        if(linkat(AT_FDCWD, procName, AT_FDCWD, linkName,
+                  AT_SYMLINK_FOLLOW) == 0)
+        {
+            result = rename(linkName, archiveName);
+            if(result < 0)
+            {
+                unlink(linkName);
+            }
+            break;
+        }
+        else if(errno != EEXIST)
         {
-            return i;
+            break;
         }
     }
-    return -1;
+    free(linkName);
+    return result;
 }
 
-
-
-/* Finalizes tempArchive, closes and deletes oldArchive, and renames tempArchive
- * to archiveName. numFiles is the number of files stored in tempArchive.
- * Returns 0 on success. */
-int finalizeArchive(FILE* oldArchive,
-                    char* archiveName,
-                    FILE* tempArchive,
-                    unsigned int numFiles)
+/* Finalizes tempArchive, opened by openTempArchive with the name tempName, by
+ * writing newIndex (the entries stored in tempArchive) to it, closes
+ * oldArchive, and replaces the archive named archiveName with tempArchive.
+ * Frees tempName. Returns 0 on success, -1 if tempArchive can't be written
+ * or published, in which case it's deleted and the old archive is kept. */
+static int finalizeArchive(FILE* oldArchive,
+                           char* archiveName,
+                           FILE* tempArchive,
+                           char* tempName,
+                           archiveIndex* newIndex)
 {
-    // write the updated numFiles to tempArchive
-    fseek(tempArchive, 0, SEEK_SET);
-    fwrite(&numFiles, sizeof(unsigned int), 1, tempArchive);
+    int result = 0;
+    
+    // write the index and the updated number of files to tempArchive
+    if(archiveWriteIndex(tempArchive, newIndex) < 0 ||
+       fflush(tempArchive) == EOF)
+    {
+        result = -1;
+    }
     
-    // close and delete oldArchive, and rename tempArchive to it
+    // close oldArchive, and put tempArchive in its place
     if(oldArchive)
     {
         fclose(oldArchive);
     }
+    if(result == 0)
+    {
+        result = tempName ? rename(tempName, archiveName)
+                          : publishAnonymousArchive(tempArchive, archiveName);
+    }
+    if(result < 0)
+    {
+        discardTempArchive(tempArchive, tempName);
+        return -1;
+    }
+    
     fclose(tempArchive);
-    rename(TEMP_ARCHIVE_NAME, archiveName);
+    free(tempName);
+    return 0;
+}
+
+/* Returns an archiveEntry named name for the file described by info, with
+ * the file's size, mode and modification time filled in and every other
+ * field zero */
+static archiveEntry entryForFile(char* name, const fileInfo* info)
+{
+    archiveEntry entry = {name, 0, CODEC_NONE, info->size, 0, 0};
+    entry.mode = info->mode;
+    entry.mtime = info->mtime;
+    return entry;
+}
+
+/* Writes an ENTRY_LINK entry with the name, original size, mode and
+ * modification time of file, which is a hard link to the file whose body is
+ * at targetOffset, to the current position of archive, adding it to index.
+ * Returns 0 on success, -1 on failure. */
+static int writeLinkToArchive(const archiveEntry* file,
+                              uint64_t targetOffset,
+                              FILE* archive,
+                              archiveIndex* index)
+{
+    archiveEntry entry = *file;
+    entry.flags = ENTRY_LINK;
+    entry.codec = CODEC_NONE;
+    entry.size = ARCHIVE_LINK_SIZE;
+    entry.checksum = 0;
+    
+    if(archiveWriteEntryHeader(archive, index, &entry) < 0 ||
+       fwrite(&targetOffset, ARCHIVE_LINK_SIZE, 1, archive) < 1)
+    {
+        return -1;
+    }
     return 0;
 }
 
+/* Copies the header and body of entry from oldArchive, whose entries are in
+ * oldIndex, to the current position of tempArchive, adding it to newIndex.
+ * Returns a return code of fileCopy. */
+static int copyEntryBody(FILE* oldArchive,
+                         archiveIndex* oldIndex,
+                         archiveEntry* entry,
+                         FILE* tempArchive,
+                         archiveIndex* newIndex)
+{
+    if(fseeko(oldArchive, entry->offset, SEEK_SET) < 0)
+    {
+        return COPY_SHORT_READ;
+    }
+    
+    if(archiveWriteEntryHeader(tempArchive, newIndex, entry) < 0)
+    {
+        return COPY_WRITE_ERROR;
+    }
+    
+    // chunked bodies refer to other entries' chunks, so their chunks are
+    // shared anew in tempArchive
+    if(entry->codec == CODEC_DEDUP)
+    {
+        uint64_t storedSize;
+        int copyResult = dedupCopyEntry(fileno(oldArchive),
+                                        oldIndex->dataEnd, entry, newIndex,
+                                        tempArchive, &storedSize);
+        if(copyResult == COPY_SUCCESS &&
+           archiveFinishEntry(tempArchive, newIndex,
+                              newIndex->numEntries - 1, storedSize,
+                              entry->checksum) < 0)
+        {
+            copyResult = COPY_WRITE_ERROR;
+        }
+        return copyResult;
+    }
+    
+    // compressed bodies are copied as they are stored
+    return fileCopy(oldArchive, tempArchive, entry->size, NULL);
+}
+
+/* Copies the entry at entryIndex in oldIndex from oldArchive to the current
+ * position of tempArchive, adding it to newIndex. newOffsets[i] holds the
+ * offset in tempArchive of the body copied for the entry at i in oldIndex, or
+ * 0 if it hasn't been copied, and is filled in for this entry. A link whose
+ * file was copied is pointed at the copy; one whose file wasn't is given the
+ * file's body, and later links to the same file point at it.
+ * Returns a return code of fileCopy. */
+static int copyEntry(FILE* oldArchive,
+                     archiveIndex* oldIndex,
+                     unsigned int entryIndex,
+                     FILE* tempArchive,
+                     archiveIndex* newIndex,
+                     uint64_t* newOffsets)
+{
+    archiveEntry* entry = &(oldIndex->entries[entryIndex]);
+    int copyResult;
+    
+    if(entry->flags & ENTRY_LINK)
+    {
+        int target = archiveLinkTarget(fileno(oldArchive), oldIndex,
+                                       entryIndex);
+        if(target < 0)
+        {
+            return COPY_SHORT_READ;
+        }
+        
+        if(newOffsets[target] != 0)
+        {
+            copyResult = writeLinkToArchive(entry, newOffsets[target],
+                                            tempArchive, newIndex) < 0 ?
+                         COPY_WRITE_ERROR : COPY_SUCCESS;
+        }
+        else
+        {
+            archiveEntry file = oldIndex->entries[target];
+            file.name = entry->name;
+            file.flags = 0;
+            copyResult = copyEntryBody(oldArchive, oldIndex, &file,
+                                       tempArchive, newIndex);
+            if(copyResult == COPY_SUCCESS)
+            {
+                newOffsets[target] =
+                    newIndex->entries[newIndex->numEntries - 1].offset;
+            }
+        }
+    }
+    else
+    {
+        copyResult = copyEntryBody(oldArchive, oldIndex, entry, tempArchive,
+                                   newIndex);
+    }
+    
+    if(copyResult == COPY_SUCCESS)
+    {
+        newOffsets[entryIndex] =
+            newIndex->entries[newIndex->numEntries - 1].offset;
+    }
+    return copyResult;
+}
+
 // Frees the given array with numElts elements in it
-void charArrayDelete(char** array, unsigned int numElts)
+static void charArrayDelete(char** array, unsigned int numElts)
 {
     for(unsigned int i = 0; i < numElts; i++)
     {
@@ -166,662 +487,2413 @@ void charArrayDelete(char** array, unsigned int numElts)
     free(array);
 }
 
-/* Reallocs array to hold numElts+1 uints and adds newValue to the end. Returns
- * a pointer to the new uint array. */
-unsigned int* uintArrayAdd(unsigned int* array,
-                           unsigned int numElts,
-                           unsigned int newValue)
+/* mallocs a bitmap of numBits bits, all of them clear, and returns a
+ * pointer to it. */
+static unsigned char* bitmapNew(unsigned int numBits)
 {
-    numElts++;
-    array = realloc(array, sizeof(unsigned int) * numElts);
-    array[numElts-1] = newValue;
-    return array;
+    return calloc(numBits / 8 + 1, sizeof(unsigned char));
 }
 
-// Used to pass to qsort() in printUnusedArgs. Compares 2 unsigned ints cast to
-// void*
-int compareUints(const void* a, const void* b)
+// Sets bit number 'bit' of bitmap
+static void bitmapSet(unsigned char* bitmap, unsigned int bit)
 {
-    unsigned int eltA = *(unsigned int*)a;
-    unsigned int eltB = *(unsigned int*)b;
-    
-    if(eltA < eltB) return -1;
-    else if(eltA == eltB) return 0;
-    else return 1;
+    bitmap[bit / 8] |= 1 << (bit % 8);
+}
+
+// Returns nonzero if bit number 'bit' of bitmap is set
+static char bitmapTest(unsigned char* bitmap, unsigned int bit)
+{
+    return (bitmap[bit / 8] >> (bit % 8)) & 1;
 }
 
 /* Prints messages to stderr about filename arguments that didn't cause some
  * action. fileArgs (length numFileArgs) contains the original arguments passed
- * to Far. usedArgs (length numUsedArgs) contains indicies of arguments in
- * fileArgs that DID cause some action.
- * WARNING: This function will sort usedArgs. */
-void printUnusedArgs(char** fileArgs,
-                     unsigned int numFileArgs,
-                     unsigned int* usedArgs,
-                     unsigned int numUsedArgs)
+ * to Far. usedArgs is a bitmap in which bit i is set if fileArgs[i] DID cause
+ * some action. */
+static void printUnusedArgs(char** fileArgs,
+                            unsigned int numFileArgs,
+                            unsigned char* usedArgs)
 {
-    if(usedArgs && numUsedArgs > 0)
+    for(unsigned int i = 0; i < numFileArgs; i++)
     {
-        qsort(usedArgs, numUsedArgs, sizeof(unsigned int), compareUints);
-    
-        // find unused fileArgs before usedArgs[0]
-        for(unsigned int i = 0; i < usedArgs[0]; i++)
+        if(!bitmapTest(usedArgs, i))
         {
             cannotFindArgError(fileArgs[i]);
         }
+    }
+}
 
-        // find unused fileArgs in between elements of usedArgs
-        for(unsigned int i = 1; i < numUsedArgs; i++)
-        {
-            for(unsigned int j = usedArgs[i-1] + 1; j < usedArgs[i]; j++)
-            {
-                cannotFindArgError(fileArgs[j]);
-            }
-        }
+/* Opens the archive named archiveName for reading, or returns stdin if
+ * archiveName is STDIO_ARCHIVE_NAME. Returns NULL if it can't be opened. */
+static FILE* openArchiveToRead(char* archiveName)
+{
+    if(strcmp(archiveName, STDIO_ARCHIVE_NAME) == 0)
+    {
+        return stdin;
+    }
+    return fopen(archiveName, "rb");
+}
 
-        // find unused fileArgs after the last of usedArgs
-        for(unsigned int i = usedArgs[numUsedArgs-1] + 1; i < numFileArgs; i++)
-        {
-            cannotFindArgError(fileArgs[i]);
-        }
+/* Reads the body of entry, the entry of a streamed archive whose header was
+ * just read, from the current position of stream, and writes the file it
+ * holds to dst, or nowhere if dst is NULL. If checksum isn't NULL, the file
+ * is checksummed into it. streamEnd is the size of stream as returned by
+ * fileLength. Sets *size to the number of bytes the body took up.
+ * Returns a return code of fileCopy. */
+static int readStreamBody(FILE* stream,
+                          off_t streamEnd,
+                          archiveEntry* entry,
+                          FILE* dst,
+                          uint32_t* checksum,
+                          uint64_t* size)
+{
+    *size = entry->size;
+    
+    if(entry->codec != CODEC_NONE)
+    {
+        return codecDecompressFile(codecFind(entry->codec), stream, dst,
+                                   entry->originalSize, size, checksum);
     }
-    else // none of fileArgs were used, so print an error message for them all
+    else if(!dst && !checksum)
     {
-        for(unsigned int i = 0; i < numFileArgs; i++)
-        {
-            cannotFindArgError(fileArgs[i]);
-        }
+        return fileSkip(stream, entry->size, streamEnd);
+    }
+    return fileCopy(stream, dst, entry->size, checksum);
+}
+
+/* Reads the body of the ENTRY_LINK entry whose header was just read from the
+ * streamed archive stream into the end of index, and sets *target to the
+ * index in index of the earlier entry that it links to, or -1 if that entry
+ * isn't in index. Returns COPY_SUCCESS, or COPY_SHORT_READ if the stream is
+ * cut short. */
+static int readStreamLink(FILE* stream, archiveIndex* index, int* target)
+{
+    uint64_t targetOffset;
+    
+    if(fread(&targetOffset, sizeof(uint64_t), 1, stream) < 1)
+    {
+        return COPY_SHORT_READ;
+    }
+    
+    *target = archiveIndexFindOffset(index, targetOffset);
+    if(*target >= 0 &&
+       ((unsigned int)*target >= index->numEntries - 1 ||
+        (index->entries[*target].flags & ENTRY_LINK)))
+    {
+        *target = -1;
     }
+    return COPY_SUCCESS;
 }
 
 /*******************************************************************************
 ********************************** farAdd **************************************
 *******************************************************************************/
 
+void farSetCompress(char compress)
+{
+    compressor = compress ? codecFind(CODEC_LZ) : NULL;
+}
+
+void farSetDedup(char on)
+{
+    dedup = on;
+}
+
 /* Writes the contents of the open file 'fileToAdd' with the name 'filename'
- * and size in bytes 'fileSize' to the open file 'archive'.
+ * described by 'info' to the open file 'archive'.
  * fileToAdd: the file to write to the archive
  * filename: the name of the file to add
- * fileSize: the size in bytes of the file to add
+ * info: the size, mode and modification time of the file to add
  * archive: the archive to which we should write fileToAdd
+ * index: the index of archive, to which the new entry is added
+ * compressPool: threads to compress blocks with, or NULL
  *
- * Returns -1 on failure, 0 on success. */
-int writeFileToArchive(FILE* fileToAdd,
-                       char* filename,
-                       unsigned int fileSize,
-                       FILE* archive)
+ * The body is cut into shared chunks if deduplication is on, and compressed
+ * if compression is on. The file is checksummed as it's read, and the
+ * checksum is stored in the entry's header. If fileToAdd turns out to be
+ * shorter than its size or archive can't be written, the partial entry is
+ * removed from index and archive's position is moved back to where the entry
+ * began. Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR. */
+static int writeFileToArchive(FILE* fileToAdd,
+                              char* filename,
+                              const fileInfo* info,
+                              FILE* archive,
+                              archiveIndex* index,
+                              threadPool* compressPool)
 {
-    fwrite(filename, sizeof(char), strlen(filename) + 1, archive);
-    fwrite(&fileSize, sizeof(unsigned int), 1, archive);
-
-    int c;
-    for(unsigned int i = 0; i < fileSize; i++)
+    off_t entryStart = ftello(archive);
+    uint64_t fileSize = info->size; // the size of fileToAdd
+    archiveEntry entry = entryForFile(filename, info); // the new entry; its
+                        // checksum and a compressed body's size are set once
+                        // it's written
+    uint32_t checksum = CRC32C_INIT; // the checksum of fileToAdd
+    uint64_t storedSize = fileSize; // the size of the body
+    int copyResult;
+    
+    entry.flags = ENTRY_CHECKSUMMED;
+    if(dedup && fileSize > 0)
+    {
+        entry.codec = CODEC_DEDUP;
+    }
+    else if(compressor && fileSize > 0)
     {
-        c = fgetc(fileToAdd);
-        if(c == EOF)
+        entry.codec = compressor->id;
+    }
+    entry.size = fileSize;
+    
+    if(entry.codec == CODEC_NONE && fileSize <= SMALL_FILE_SIZE)
+    {
+        char* contents = malloc(fileSize + 1);
+        if(!contents ||
+           fread(contents, sizeof(char), fileSize, fileToAdd) < fileSize)
         {
-            return -1;
+            free(contents);
+            return COPY_SHORT_READ;
         }
-        else
+        entry.checksum = crc32cUpdate(CRC32C_INIT, contents, fileSize);
+        copyResult = COPY_SUCCESS;
+        if(archiveWriteEntryHeader(archive, index, &entry) < 0)
+        {
+            fseeko(archive, entryStart, SEEK_SET);
+            copyResult = COPY_WRITE_ERROR;
+        }
+        else if(fwrite(contents, sizeof(char), fileSize, archive) < fileSize)
         {
-            fputc(c, archive);
+            archiveIndexRemoveLast(index);
+            fseeko(archive, entryStart, SEEK_SET);
+            copyResult = COPY_WRITE_ERROR;
         }
+        free(contents);
+        return copyResult;
     }
     
-    return 0;
-}
-
-FAR_RTRN farAdd(char* archiveName, char** fileArgs, unsigned char numFileArgs)
-{
-    FILE* oldArchive; // the archive file named archiveName
-    FILE* tempArchive; // the temp archive with name TEMP_ARCHIVE_NAME
-    FILE* fileToAdd = NULL; // a file with name from fileArgs to add to the
-                            // archive
-    
-    unsigned int newNumFiles = 0; // the total number of files in the NEW
-                                  // archive
-    unsigned int oldNumFiles; // the total number of files in the OLD archive
-    
-    charBuffer* filename; // the name of a file being copied from oldArchive
-    unsigned int fileSize; // the size of the current file in oldArchive
-    
-    struct stat fileStat; // holds data from any stat() calls
-    DIR* dir; // pointer to a directory-type file with name from fileArgs
-    
-    // check for no-args
-    if(numFileArgs == 0)
+    if(archiveWriteEntryHeader(archive, index, &entry) < 0)
     {
-        return SUCCESS;
+        fseeko(archive, entryStart, SEEK_SET);
+        return COPY_WRITE_ERROR;
     }
     
-    /* eliminates invalid args (and prints errors) and expands directories to
-     * include their contents */
-    fileList* validArgs = fileListNew(fileArgs, numFileArgs);
-    
-    oldArchive = fopen(archiveName, "rb+");
-    
-    // read the number of files in oldArchive
-    if(oldArchive)
+    // a stored body is copied by the kernel when it can be, without passing
+    // through this process, and checksummed from what was written; any other
+    // file is checksummed as it's read, so it's read only once
+    if(entry.codec == CODEC_NONE)
     {
-        if(fread(&oldNumFiles, sizeof(unsigned int), 1, oldArchive) < 1)
+        off_t bodyStart = index->entries[index->numEntries - 1].offset;
+        copyResult = fileCopy(fileToAdd, archive, fileSize, NULL);
+        if(copyResult == COPY_SUCCESS &&
+           (fflush(archive) == EOF ||
+            fileChecksumRange(fileno(archive), bodyStart, fileSize,
+                              &checksum) != COPY_SUCCESS))
         {
-            fclose(oldArchive);
-            fileListDelete(validArgs);
-            return corruptedArchiveError();
+            copyResult = COPY_WRITE_ERROR;
         }
     }
+    else if(entry.codec == CODEC_DEDUP)
+    {
+        copyResult = dedupWriteFile(index, compressor, fileToAdd, archive,
+                                    fileSize, &storedSize, &checksum);
+    }
     else
     {
-        oldNumFiles = 0;
+        copyResult = codecCompressFile(compressor, compressPool, fileToAdd,
+                                       archive, fileSize, &storedSize,
+                                       &checksum);
     }
     
-    // open the temp archive and check for error
-    tempArchive = fopen(TEMP_ARCHIVE_NAME, "wb+");
-    if(!tempArchive)
+    if(copyResult == COPY_SUCCESS &&
+       archiveFinishEntry(archive, index, index->numEntries - 1, storedSize,
+                          checksum) < 0)
     {
-        fclose(oldArchive);
-        fileListDelete(validArgs);
-        return openTempArchiveError();
+        copyResult = COPY_WRITE_ERROR;
     }
     
-    // write numFiles simply to reserve the uint space;
-    // it will be overwritten at the end
-    fwrite(&newNumFiles, sizeof(unsigned int), 1, tempArchive);
-    
-    filename = charBufferNew();
-    
-    // copy oldArchive to tempArchive, not copying any entries that appear in
-    // validArgs
-    for(unsigned int i = 0; i < oldNumFiles; i++)
+    if(copyResult != COPY_SUCCESS)
     {
-        // get filename and fileSize
-        if(getFileName(oldArchive, filename) ||
-           fread(&fileSize, sizeof(unsigned int), 1, oldArchive) < 1)
-        {
-            fclose(oldArchive);
-            fclose(tempArchive);
-            unlink(TEMP_ARCHIVE_NAME);
-            charBufferDelete(filename);
-            fileListDelete(validArgs);
-            return corruptedArchiveError();
-        }
-        
-        // check if filename appears in validArgs
-        char shouldCopy = (isDuplicateFile(filename->str,
-                           validArgs->names,
-                           validArgs->numNames) < 0);
-        
-        // write filename and file size
-        if(shouldCopy)
-        {
-            fwrite(filename->str,
-                   sizeof(char),
-                   filename->len,
-                   tempArchive);
-            fwrite(&fileSize, sizeof(unsigned int), 1, tempArchive);
-            newNumFiles++;
-        }
-        
-        // read file contents and write to tempArchive if shouldCopy
-        for(unsigned int j = 0; j < fileSize; j++)
-        {
-            int c = fgetc(oldArchive);
-            if(c == EOF)
-            {
-                fclose(oldArchive);
-                fclose(tempArchive);
-                unlink(TEMP_ARCHIVE_NAME);
-                charBufferDelete(filename);
-                fileListDelete(validArgs);
-                return corruptedArchiveError();
-            }
-            else if(shouldCopy)
-            {
-                fputc(c, tempArchive);
-            }
-        }
+        archiveIndexRemoveLast(index);
+        fseeko(archive, entryStart, SEEK_SET);
     }
+    return copyResult;
+}
+
+/* Writes each file in validArgs that isn't a repeat of an earlier one to the
+ * current position of archive, adding the new entries to index. argSet is a
+ * nameSet of validArgs->names. Bit i of unchanged is set if
+ * validArgs->names[i] is already archived as it is and should be skipped;
+ * unchanged may be NULL. The types and sizes of the files come from
+ * validArgs, so each regular file is only opened. compressPool holds the
+ * threads that compress blocks, or is NULL. A hard link to a file added
+ * earlier in the same call is written as a link entry, without its data.
+ * Prints a message to stderr for each file that can't be read. Returns 0 on
+ * success, or -1 if archive can't be written, in which case the entries
+ * written before the failure are left in index. */
+static int appendFiles(FILE* archive,
+                       archiveIndex* index,
+                       fileList* validArgs,
+                       nameSet* argSet,
+                       unsigned char* unchanged,
+                       threadPool* compressPool)
+{
+    FILE* fileToAdd; // a file with name from validArgs to add to the archive
+    int result = 0;
     
-    // append new files to the end of tempArchive
-    for(unsigned int i = 0; i < validArgs->numNames; i++)
+    // bodyOffsets[i] is the offset of the body written for validArgs->names[i]
+    // in archive, or 0 if there's none
+    uint64_t* bodyOffsets = calloc(validArgs->numNames + 1, sizeof(uint64_t));
+    
+    for(unsigned int i = 0; result == 0 && i < validArgs->numNames; i++)
     {
-        if(isDuplicateFile(validArgs->names[i], validArgs->names, i) >= 0)
-        {
-            continue;
-        }
+        unsigned int firstName = validArgs->infos[i].firstName;
         
-        // call stat on the file
-        if(stat(validArgs->names[i], &fileStat) < 0)
+        // skip names that appeared earlier in validArgs
+        if(nameSetFind(argSet, validArgs->names[i]) < (int)i ||
+           (unchanged && bitmapTest(unchanged, i)))
         {
-            fileOpenError(validArgs->names[i]);
             continue;
         }
         
-        // check if directory
-        dir = opendir(validArgs->names[i]);
-        if(dir)
+        if(validArgs->infos[i].isDir)
         {            
-            // write directory name to archive
-            fwrite(validArgs->names[i],
-                   sizeof(char),
-                   strlen(validArgs->names[i]) + 1,
-                   tempArchive);
-            
-            // write directory size (zero) to archive
-            fileSize = 0;
-            fwrite(&fileSize, sizeof(unsigned int), 1, tempArchive);
-            
-            newNumFiles++;
-            
-            closedir(dir);
+            // write directory name, size (zero), mode and time to archive
+            archiveEntry entry = entryForFile(validArgs->names[i],
+                                              &(validArgs->infos[i]));
+            entry.originalSize = 0;
+            result = archiveWriteEntryHeader(archive, index, &entry);
+        }
+        else if(firstName != i && bodyOffsets[firstName] != 0)
+        {
+            archiveEntry link = entryForFile(validArgs->names[i],
+                                             &(validArgs->infos[i]));
+            result = writeLinkToArchive(&link, bodyOffsets[firstName],
+                                        archive, index);
         }
         else
         {
-            // add this regular file to tempArchive
+            // add this regular file to archive; this open is the only check
+            // that it can be read
             fileToAdd = fopen(validArgs->names[i], "rb");
-            fileSize = fileStat.st_size;
-            
-            writeFileToArchive(fileToAdd,
-                               validArgs->names[i],
-                               fileSize,
-                               tempArchive);
-            
-            fclose(fileToAdd);
+            int copyResult = !fileToAdd ? COPY_SHORT_READ :
+                             writeFileToArchive(fileToAdd,
+                                                validArgs->names[i],
+                                                &(validArgs->infos[i]),
+                                                archive,
+                                                index,
+                                                compressPool);
+            if(copyResult == COPY_WRITE_ERROR)
+            {
+                result = -1;
+            }
+            else if(copyResult != COPY_SUCCESS)
+            {
+                fileOpenError(validArgs->names[i]);
+            }
+            else
+            {
+                bodyOffsets[i] = index->entries[index->numEntries - 1].offset;
+            }
             
-            // update numFiles
-            newNumFiles++;
+            if(fileToAdd) fclose(fileToAdd);
         }
     }
-    
-    finalizeArchive(oldArchive, archiveName, tempArchive, newNumFiles);
-    
-    // clean-up
-    charBufferDelete(filename);
-    fileListDelete(validArgs);
-    return SUCCESS;
+    free(bodyOffsets);
+    return result;
 }
 
-/*******************************************************************************
-******************************** farExtract ************************************
-*******************************************************************************/
-
-/* Checks to see if the directory named dirname exists and creates it if it
- * doesn't. Prints message to stderr upon failure. */
-void ensureDirExists(char* dirname)
+/* Returns 1 if entry, an entry that isn't deleted, is archived the same as
+ * the file described by info: they have the same type and permissions, and a
+ * regular file also has the same size and modification time. Entries of
+ * legacy archives never match. */
+static char entryMatchesFile(archiveEntry* entry, const fileInfo* info)
 {
-    DIR* dir = opendir(dirname);
-    
-    if(dir == NULL)
-    {
-        if(errno == EACCES) // if permission denied
-        {
-            dirOpenError(dirname);
-        }
-        else if(mkdir(dirname, 0777) < 0) // try to make the directory
-        {
-            dirOpenError(dirname);
-        }
-    }
-    else
+    if(entry->mode == 0 || entry->mode != (uint32_t)info->mode)
     {
-        closedir(dir);
+        return 0;
     }
+    return info->isDir || (entry->originalSize == (uint64_t)info->size &&
+                           entry->mtime == (int64_t)info->mtime);
 }
 
-/* Extracts the file named filename with size fileSize from archive. The file
- * pointer in archive must be pointing to the beginning of the body of the file
- * to extract. Prints a message to stderr if the extraction cannot be done.
- * Moves the file pointer to the end of the body of the file extracted.
- * Returns -1 if the archive is corrupted, else returns 0. */
-char extractFile(FILE* archive, char* filename, unsigned int fileSize)
+/* Returns 1 if entry, an entry that isn't deleted, is replaced by one of the
+ * files in argSet: its name is in argSet, and the bit of unchanged for that
+ * name isn't set. unchanged may be NULL. Otherwise returns 0. */
+static char entryReplaced(archiveEntry* entry,
+                          nameSet* argSet,
+                          unsigned char* unchanged)
 {
-    int currentLen = 0;
-    char* currentStr = NULL;
-    
-    while(currentLen < strlen(filename))
+    int argIndex = nameSetFind(argSet, entry->name);
+    return argIndex >= 0 && !(unchanged && bitmapTest(unchanged, argIndex));
+}
+
+/* Returns 1 if the files in argSet can be written straight onto the end of
+ * the archive described by oldIndex: the archive is of the current version
+ * and either none of its entries are being replaced or, when updating
+ * (unchanged isn't NULL), the replaced entries can be marked deleted in
+ * place. Otherwise returns 0. */
+static char canAppendInPlace(archiveIndex* oldIndex,
+                             nameSet* argSet,
+                             unsigned char* unchanged)
+{
+    if(oldIndex->version != ARCHIVE_VERSION)
+    {
+        return 0; // older archives are rewritten in the current format
+    }
+    else if(unchanged)
+    {
+        return 1;
+    }
+    
+    for(unsigned int i = 0; i < oldIndex->numEntries; i++)
+    {
+        if(!(oldIndex->entries[i].flags & ENTRY_DELETED) &&
+           entryReplaced(&(oldIndex->entries[i]), argSet, NULL))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Commits changes made in place to the archive open as archive, of which
+ * index holds the entries, by writing index at archive's current position,
+ * which should be just past the last body. Entries deleted by the change are
+ * flagged ENTRY_DELETED in index only, and bit i of deleted is set for each
+ * entry i among them; their headers are marked once the new index and number
+ * of entries are on disk, so a crash before then leaves the archive as it
+ * was. Returns 0 on success, or -1 if the index can't be written, in which
+ * case the header still holds the old number of entries. Returns 1 if the
+ * change was committed but the headers couldn't all be marked. */
+static int commitInPlace(FILE* archive,
+                         archiveIndex* index,
+                         unsigned char* deleted)
+{
+    if(archiveWriteIndex(archive, index) < 0)
+    {
+        return -1;
+    }
+    
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        if(bitmapTest(deleted, i) &&
+           archiveMarkDeleted(archive, index, i) < 0)
+        {
+            return 1;
+        }
+    }
+    return (fflush(archive) == EOF) ? 1 : 0;
+}
+
+/* Undoes a change to the archive open as archive that commitInPlace didn't
+ * commit: removes the entries past the first numEntries and the chunks past
+ * the first numChunks from index, clears the deletions marked in deleted,
+ * and writes index back at index->dataEnd, over whatever was written there.
+ * Until this succeeds, readers find the entries from their headers, which
+ * still hold the archive as it was. */
+static void restoreInPlace(FILE* archive,
+                           archiveIndex* index,
+                           unsigned int numEntries,
+                           unsigned int numChunks,
+                           unsigned char* deleted)
+{
+    while(index->numEntries > numEntries)
+    {
+        archiveIndexRemoveLast(index);
+    }
+    archiveIndexTruncateChunks(index, numChunks);
+    
+    for(unsigned int i = 0; i < numEntries; i++)
+    {
+        if(bitmapTest(deleted, i))
+        {
+            index->entries[i].flags &= ~ENTRY_DELETED;
+        }
+    }
+    
+    if(fseeko(archive, index->dataEnd, SEEK_SET) == 0)
+    {
+        archiveWriteIndex(archive, index);
+    }
+}
+
+/* Adds the files in validArgs to the archive named archiveName, which is
+ * created if it doesn't exist, and frees validArgs. Entries with the same
+ * names as the files are replaced. If update is nonzero, files that are
+ * archived with the same type, size, permissions and modification time are
+ * left as they are, and the entries of the files that changed are marked
+ * deleted in place when the archive is of the current version.
+ * Returns a code of FAR_RTRN. */
+static FAR_RTRN addFiles(char* archiveName, fileList* validArgs, char update)
+{
+    FILE* oldArchive; // the archive file named archiveName
+    FILE* tempArchive; // the temp archive that replaces the old one
+    char* tempName; // the name of tempArchive, or NULL if it has none
+    
+    archiveIndex* oldIndex = NULL; // the entries in the OLD archive
+    archiveIndex* newIndex; // the entries in the NEW archive
+    
+    nameSet* argSet = nameSetNew(validArgs->names, validArgs->numNames);
+    
+    // bit i is set if validArgs->names[i] is archived as it is; only used
+    // when updating
+    unsigned char* unchanged = update ? bitmapNew(validArgs->numNames) : NULL;
+    
+    // the threads that compress the blocks of each file
+    threadPool* compressPool = NULL;
+    if(compressor && !dedup && numThreads > 1)
+    {
+        compressPool = threadPoolNew(numThreads,
+                                     numThreads * QUEUE_PER_THREAD);
+    }
+    
+    oldArchive = fopen(archiveName, "rb+");
+    
+    // read the entries in oldArchive
+    if(oldArchive)
+    {
+        oldIndex = archiveIndexRead(oldArchive, NULL);
+        if(!oldIndex)
+        {
+            FAR_RTRN error = unmodifiableArchiveError(oldArchive);
+            fclose(oldArchive);
+            nameSetDelete(argSet);
+            free(unchanged);
+            fileListDelete(validArgs);
+            if(compressPool) threadPoolDelete(compressPool);
+            return error;
+        }
+        
+        // find the files that are archived as they are
+        for(unsigned int i = 0; unchanged && i < oldIndex->numEntries; i++)
+        {
+            archiveEntry* entry = &(oldIndex->entries[i]);
+            int argIndex = nameSetFind(argSet, entry->name);
+            
+            if(!(entry->flags & ENTRY_DELETED) && argIndex >= 0 &&
+               entryMatchesFile(entry, &(validArgs->infos[argIndex])))
+            {
+                bitmapSet(unchanged, argIndex);
+            }
+        }
+        
+        /* if nothing is being replaced, or the replaced entries can be
+         * marked deleted, write the new files over the old index and write a
+         * new index after them. The header still holds the old number of
+         * files until everything else is on disk, and the replaced entries
+         * are only marked in their headers after that, so a crash leaves the
+         * archive as it was */
+        if(canAppendInPlace(oldIndex, argSet, unchanged))
+        {
+            unsigned int oldNumEntries = oldIndex->numEntries;
+            unsigned int oldNumChunks = oldIndex->numChunks;
+            
+            int result = -1;
+            if(fseeko(oldArchive, oldIndex->dataEnd, SEEK_SET) == 0)
+            {
+                result = appendFiles(oldArchive, oldIndex, validArgs, argSet,
+                                     unchanged, compressPool);
+            }
+            
+            // bit i is set if the entry at i is replaced
+            unsigned char* replaced = bitmapNew(oldIndex->numEntries);
+            for(unsigned int i = 0; i < oldNumEntries; i++)
+            {
+                archiveEntry* entry = &(oldIndex->entries[i]);
+                if(!(entry->flags & ENTRY_DELETED) &&
+                   entryReplaced(entry, argSet, unchanged))
+                {
+                    entry->flags |= ENTRY_DELETED;
+                    bitmapSet(replaced, i);
+                }
+            }
+            
+            if(result == 0)
+            {
+                result = commitInPlace(oldArchive, oldIndex, replaced);
+            }
+            if(result < 0)
+            {
+                restoreInPlace(oldArchive, oldIndex, oldNumEntries,
+                               oldNumChunks, replaced);
+            }
+            
+            free(replaced);
+            fclose(oldArchive);
+            archiveIndexDelete(oldIndex);
+            nameSetDelete(argSet);
+            free(unchanged);
+            fileListDelete(validArgs);
+            if(compressPool) threadPoolDelete(compressPool);
+            return (result == 0) ? SUCCESS : archiveWriteError();
+        }
+    }
+    
+    // open the temp archive and check for error
+    tempArchive = openTempArchive(archiveName, oldArchive, &tempName);
+    if(!tempArchive)
+    {
+        if(oldArchive)
+        {
+            fclose(oldArchive);
+            archiveIndexDelete(oldIndex);
+        }
+        nameSetDelete(argSet);
+        free(unchanged);
+        fileListDelete(validArgs);
+        if(compressPool) threadPoolDelete(compressPool);
+        return openTempArchiveError();
+    }
+    
+    // the number of files in the header is filled in by finalizeArchive
+    archiveWriteHeader(tempArchive);
+    newIndex = archiveIndexNew();
+    
+    // where each copied entry's body went in tempArchive, for links to it
+    uint64_t* newOffsets = calloc((oldIndex ? oldIndex->numEntries : 0) + 1,
+                                  sizeof(uint64_t));
+    
+    // copy oldArchive to tempArchive, not copying any entries that appear in
+    // validArgs
+    for(unsigned int i = 0; oldIndex && i < oldIndex->numEntries; i++)
+    {
+        archiveEntry* entry = &(oldIndex->entries[i]);
+        
+        // skip deleted entries and entries that are being replaced
+        if((entry->flags & ENTRY_DELETED) ||
+           entryReplaced(entry, argSet, unchanged))
+        {
+            continue;
+        }
+        
+        int copyResult = copyEntry(oldArchive, oldIndex, i, tempArchive,
+                                   newIndex, newOffsets);
+        if(copyResult != COPY_SUCCESS)
+        {
+            fclose(oldArchive);
+            discardTempArchive(tempArchive, tempName);
+            archiveIndexDelete(oldIndex);
+            archiveIndexDelete(newIndex);
+            free(newOffsets);
+            nameSetDelete(argSet);
+            free(unchanged);
+            fileListDelete(validArgs);
+            if(compressPool) threadPoolDelete(compressPool);
+            return copyEntryError(copyResult);
+        }
+    }
+    
+    free(newOffsets);
+    
+    // append new files to the end of tempArchive
+    FAR_RTRN returnCode = SUCCESS;
+    if(appendFiles(tempArchive, newIndex, validArgs, argSet, unchanged,
+                   compressPool) < 0)
+    {
+        if(oldArchive) fclose(oldArchive);
+        discardTempArchive(tempArchive, tempName);
+        returnCode = archiveWriteError();
+    }
+    else if(finalizeArchive(oldArchive, archiveName, tempArchive, tempName,
+                            newIndex) < 0)
+    {
+        returnCode = openTempArchiveError();
+    }
+    
+    // clean-up
+    if(oldIndex) archiveIndexDelete(oldIndex);
+    archiveIndexDelete(newIndex);
+    nameSetDelete(argSet);
+    free(unchanged);
+    fileListDelete(validArgs);
+    if(compressPool) threadPoolDelete(compressPool);
+    return returnCode;
+}
+
+FAR_RTRN farAdd(char* archiveName, char** fileArgs, unsigned int numFileArgs)
+{
+    // check for no-args
+    if(numFileArgs == 0)
+    {
+        return SUCCESS;
+    }
+    
+    /* eliminates invalid args (and prints errors) and expands directories to
+     * include their contents */
+    return addFiles(archiveName,
+                    fileListNew(fileArgs, numFileArgs, numThreads), 0);
+}
+
+FAR_RTRN farUpdate(char* archiveName,
+                   char** fileArgs,
+                   unsigned int numFileArgs)
+{
+    if(numFileArgs == 0)
+    {
+        return SUCCESS;
+    }
+    
+    return addFiles(archiveName,
+                    fileListNew(fileArgs, numFileArgs, numThreads), 1);
+}
+
+/*******************************************************************************
+********************************* farCreate ************************************
+*******************************************************************************/
+
+/* Writes the contents of the open file fileToAdd, named filename and
+ * described by info, to the end of the streamed archive stream, adding the
+ * entry to index. The body is compressed if compression is on, by the
+ * threads of compressPool if it isn't NULL, and the file's checksum is
+ * written after it. Returns a return code of fileCopy; after
+ * COPY_SHORT_READ, which means that fileToAdd shrank, stream holds a partial
+ * body and can't be finished. */
+static int writeFileToStream(FILE* fileToAdd,
+                             char* filename,
+                             const fileInfo* info,
+                             FILE* stream,
+                             archiveIndex* index,
+                             threadPool* compressPool)
+{
+    archiveEntry entry = entryForFile(filename, info);
+    uint32_t checksum = CRC32C_INIT; // the checksum of fileToAdd
+    uint64_t storedSize = entry.originalSize; // the size of the body
+    int copyResult;
+    
+    entry.flags = ENTRY_CHECKSUMMED;
+    if(compressor && entry.originalSize > 0)
+    {
+        entry.codec = compressor->id;
+    }
+    
+    if(archiveStreamWriteEntryHeader(stream, index, &entry) < 0)
+    {
+        return COPY_WRITE_ERROR;
+    }
+    
+    if(entry.codec == CODEC_NONE)
+    {
+        copyResult = fileCopy(fileToAdd, stream, entry.originalSize,
+                              &checksum);
+    }
+    else
+    {
+        copyResult = codecCompressFile(compressor, compressPool, fileToAdd,
+                                       stream, entry.originalSize,
+                                       &storedSize, &checksum);
+    }
+    
+    if(copyResult == COPY_SUCCESS &&
+       archiveStreamWriteTrailer(stream, index, storedSize, checksum) < 0)
+    {
+        copyResult = COPY_WRITE_ERROR;
+    }
+    return copyResult;
+}
+
+FAR_RTRN farCreate(char* archiveName,
+                   char** fileArgs,
+                   unsigned int numFileArgs)
+{
+    FILE* stream; // the archive named archiveName, or stdout
+    FILE* fileToAdd; // a file with name from validArgs to add to the archive
+    archiveIndex* index; // the entries written to stream
+    int copyResult = COPY_SUCCESS;
+    
+    /* eliminates invalid args (and prints errors) and expands directories to
+     * include their contents */
+    fileList* validArgs = fileListNew(fileArgs, numFileArgs, numThreads);
+    nameSet* argSet = nameSetNew(validArgs->names, validArgs->numNames);
+    
+    // the threads that compress the blocks of each file
+    threadPool* compressPool = NULL;
+    if(compressor && numThreads > 1)
+    {
+        compressPool = threadPoolNew(numThreads,
+                                     numThreads * QUEUE_PER_THREAD);
+    }
+    
+    stream = (strcmp(archiveName, STDIO_ARCHIVE_NAME) == 0) ?
+             stdout : fopen(archiveName, "wb");
+    if(!stream)
+    {
+        nameSetDelete(argSet);
+        fileListDelete(validArgs);
+        if(compressPool) threadPoolDelete(compressPool);
+        return invalidArchiveNameError();
+    }
+    
+    index = archiveIndexNew();
+    if(archiveStreamWriteHeader(stream, index) < 0)
+    {
+        copyResult = COPY_WRITE_ERROR;
+    }
+    
+    // bodyOffsets[i] is the offset of the body written for validArgs->names[i]
+    // in stream, or 0 if there's none
+    uint64_t* bodyOffsets = calloc(validArgs->numNames + 1, sizeof(uint64_t));
+    
+    // the entries are written as appendFiles writes them, but nothing that's
+    // written is ever gone back to
+    for(unsigned int i = 0;
+        copyResult == COPY_SUCCESS && i < validArgs->numNames;
+        i++)
+    {
+        unsigned int firstName = validArgs->infos[i].firstName;
+        archiveEntry entry = entryForFile(validArgs->names[i],
+                                          &(validArgs->infos[i]));
+        
+        // skip names that appeared earlier in validArgs
+        if(nameSetFind(argSet, validArgs->names[i]) < (int)i)
+        {
+            continue;
+        }
+        
+        if(validArgs->infos[i].isDir)
+        {
+            entry.originalSize = 0;
+            if(archiveStreamWriteEntryHeader(stream, index, &entry) < 0 ||
+               archiveStreamWriteTrailer(stream, index, 0, 0) < 0)
+            {
+                copyResult = COPY_WRITE_ERROR;
+            }
+        }
+        else if(firstName != i && bodyOffsets[firstName] != 0)
+        {
+            entry.flags = ENTRY_LINK;
+            if(archiveStreamWriteEntryHeader(stream, index, &entry) < 0 ||
+               fwrite(&(bodyOffsets[firstName]), sizeof(uint64_t), 1,
+                      stream) < 1 ||
+               archiveStreamWriteTrailer(stream, index, ARCHIVE_LINK_SIZE,
+                                         0) < 0)
+            {
+                copyResult = COPY_WRITE_ERROR;
+            }
+        }
+        else
+        {
+            // this open is the only check that the file can be read
+            fileToAdd = fopen(validArgs->names[i], "rb");
+            if(!fileToAdd)
+            {
+                fileOpenError(validArgs->names[i]);
+                continue;
+            }
+            
+            copyResult = writeFileToStream(fileToAdd, validArgs->names[i],
+                                           &(validArgs->infos[i]), stream,
+                                           index, compressPool);
+            if(copyResult == COPY_SHORT_READ)
+            {
+                fileOpenError(validArgs->names[i]);
+            }
+            bodyOffsets[i] = index->entries[index->numEntries - 1].offset;
+            fclose(fileToAdd);
+        }
+    }
+    
+    if(copyResult == COPY_SUCCESS && archiveStreamWriteEnd(stream) < 0)
+    {
+        copyResult = COPY_WRITE_ERROR;
+    }
+    if(fclose(stream) == EOF)
+    {
+        copyResult = COPY_WRITE_ERROR;
+    }
+    
+    // clean-up
+    free(bodyOffsets);
+    archiveIndexDelete(index);
+    nameSetDelete(argSet);
+    fileListDelete(validArgs);
+    if(compressPool) threadPoolDelete(compressPool);
+    return (copyResult == COPY_SUCCESS) ? SUCCESS : streamWriteError();
+}
+
+/*******************************************************************************
+******************************** farExtract ************************************
+*******************************************************************************/
+
+void farSetNumThreads(unsigned int threads)
+{
+    numThreads = (threads > 0) ? threads : 1;
+}
+
+/* Makes sure the directories in filename exist, looking them up in dirs and
+ * only creating them when they aren't there. Sets *dirFd to a handle to the
+ * directory that holds the file (AT_FDCWD if there's none) and *relName to
+ * the file's name relative to *dirFd, which is "" for a directory. Prints a
+ * message to stderr and returns -1 if a directory can't be created, else
+ * returns 0. */
+static int ensureParentDir(dirCache* dirs,
+                           char* filename,
+                           int* dirFd,
+                           char** relName)
+{
+    char* lastSlash = strrchr(filename, '/');
+    char* basename = lastSlash ? lastSlash + 1 : filename; // name in its dir
+    
+    *dirFd = AT_FDCWD;
+    if(lastSlash &&
+       dirCacheEnsure(dirs, filename, basename - filename, dirFd) < 0)
+    {
+        char* dirname = malloc(sizeof(char) * (basename - filename + 1));
+        strncpy(dirname, filename, basename - filename);
+        dirname[basename - filename] = '\0';
+        dirOpenError(dirname);
+        free(dirname);
+        
+        if(*basename != '\0')
+        {
+            fileOpenError(filename);
+        }
+        return -1;
+    }
+    
+    // without a handle to the directory, name the file by its whole path
+    if(*basename == '\0' || *dirFd != AT_FDCWD)
+    {
+        *relName = basename;
+    }
+    else
+    {
+        *relName = filename;
+    }
+    return 0;
+}
+
+/* Extracts entry from the archive read through archiveMap, whose bodies end
+ * at dataEnd. The directories in its name are looked up in dirs, and only
+ * created when they aren't there; the file is then created relative to its
+ * directory's handle, so the cost per file doesn't grow with the depth of its
+ * path. The body is written straight from the archive's mapping when it has
+ * one, and otherwise read with positional reads, so several threads may
+ * extract from the same archiveMap at once. Prints a message to stderr if the
+ * extraction cannot be done.
+ * Returns -1 if the archive is corrupted, 1 if a regular file was written in
+ * full, else returns 0. */
+static char extractFile(const fileMap* archiveMap,
+                        uint64_t dataEnd,
+                        dirCache* dirs,
+                        archiveEntry* entry)
+{
+    char* filename = entry->name;
+    char* relName; // the name of the file relative to dirFd
+    int dirFd; // the directory that holds the file
+    
+    if(ensureParentDir(dirs, filename, &dirFd, &relName) < 0 ||
+       *relName == '\0') // a directory, which now exists
+    {
+        return 0;
+    }
+    
+    int extractedFd = openat(dirFd, relName, O_WRONLY | O_CREAT | O_TRUNC,
+                             0666);
+    
+    if(extractedFd >= 0)
+    {
+        int copyResult;
+        
+        if(entry->codec == CODEC_NONE)
+        {
+            copyResult = fileMapCopyRange(archiveMap, entry->offset,
+                                          extractedFd, 0, entry->size);
+        }
+        else if(entry->codec == CODEC_DEDUP)
+        {
+            copyResult = dedupExtractRange(archiveMap, dataEnd, entry,
+                                           extractedFd, NULL);
+        }
+        else if(codecFind(entry->codec))
+        {
+            copyResult = codecDecompressRange(codecFind(entry->codec),
+                                              archiveMap, entry->offset,
+                                              entry->size, extractedFd,
+                                              entry->originalSize, NULL);
+        }
+        else
+        {
+            copyResult = COPY_SHORT_READ; // an unknown codec
+        }
+        close(extractedFd);
+        
+        if(copyResult == COPY_SHORT_READ)
+        {
+            return -1;
+        }
+        else if(copyResult == COPY_WRITE_ERROR)
+        {
+            fileOpenError(filename);
+        }
+        else
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        fileOpenError(filename);
+    }
+    
+    return 0;
+}
+
+/* Extracts the ENTRY_LINK entry link, a hard link to the file of the entry
+ * target, from the archive read through archiveMap, as extractFile does. If target
+ * was written in full by this extraction (targetWritten is nonzero), link is
+ * made a hard link to it; otherwise, or if the link can't be made, target's
+ * body is written to link's name instead.
+ * Returns -1 if the archive is corrupted, else returns 0. */
+static char extractLink(const fileMap* archiveMap,
+                        uint64_t dataEnd,
+                        dirCache* dirs,
+                        archiveEntry* link,
+                        archiveEntry* target,
+                        char targetWritten)
+{
+    char* relName; // the name of the link relative to dirFd
+    int dirFd; // the directory that holds the link
+    
+    if(targetWritten)
+    {
+        if(ensureParentDir(dirs, link->name, &dirFd, &relName) < 0)
+        {
+            return 0;
+        }
+        
+        // replace whatever has the link's name, as extracting a file would
+        if((unlinkat(dirFd, relName, 0) == 0 || errno == ENOENT) &&
+           linkat(AT_FDCWD, target->name, dirFd, relName, 0) == 0)
+        {
+            return 0;
+        }
+    }
+    
+    archiveEntry copy = *target; // target's body under link's name
+    copy.name = link->name;
+    return (extractFile(archiveMap, dataEnd, dirs, &copy) < 0) ? -1 : 0;
+}
+
+// the state shared by the worker threads of one parallel extraction
+typedef struct
+{
+    const fileMap* archiveMap; // the archive being extracted from
+    uint64_t dataEnd; // the end of the bodies in the archive
+    dirCache* dirs; // the directories created or found so far
+    char* written; // written[i] is set once entry i is written in full
+    char corrupted; // set by a worker that finds the archive corrupted
+    pthread_mutex_t lock; // guards corrupted
+} extractJob;
+
+// one entry for a worker thread to extract
+typedef struct
+{
+    extractJob* job; // the extraction the entry belongs to
+    archiveEntry* entry; // the entry to extract
+    char* written; // where to record that the entry was written in full
+} extractTask;
+
+/* A threadPoolTask that extracts one entry. Frees its extractTask. */
+static void extractFileTask(void* taskArg)
+{
+    extractTask* task = taskArg;
+    char result = extractFile(task->job->archiveMap, task->job->dataEnd,
+                              task->job->dirs, task->entry);
+    
+    if(result < 0)
+    {
+        pthread_mutex_lock(&(task->job->lock));
+        task->job->corrupted = 1;
+        pthread_mutex_unlock(&(task->job->lock));
+    }
+    *(task->written) = (result > 0);
+    free(task);
+}
+
+/* Extracts entry, the entry of a streamed archive whose header was just
+ * read, from the current position of stream as extractFile does. streamEnd
+ * is the size of stream as returned by fileLength. Sets *size to the number
+ * of bytes the body took up, and *written to 1 if a regular file was written
+ * in full. The body is read even if the file can't be created. Prints a
+ * message to stderr if the extraction cannot be done.
+ * Returns a return code of fileCopy. */
+static int extractStreamFile(FILE* stream,
+                             off_t streamEnd,
+                             dirCache* dirs,
+                             archiveEntry* entry,
+                             uint64_t* size,
+                             char* written)
+{
+    char* relName; // the name of the file relative to dirFd
+    int dirFd; // the directory that holds the file
+    FILE* extracted = NULL; // the file being written
+    
+    *written = 0;
+    if(ensureParentDir(dirs, entry->name, &dirFd, &relName) == 0 &&
+       *relName != '\0') // not a directory, which now exists
+    {
+        int extractedFd = openat(dirFd, relName, O_WRONLY | O_CREAT | O_TRUNC,
+                                 0666);
+        extracted = (extractedFd >= 0) ? fdopen(extractedFd, "wb") : NULL;
+        if(!extracted)
+        {
+            if(extractedFd >= 0) close(extractedFd);
+            fileOpenError(entry->name);
+        }
+    }
+    
+    int copyResult = readStreamBody(stream, streamEnd, entry, extracted, NULL,
+                                    size);
+    if(extracted)
+    {
+        if(fclose(extracted) == EOF && copyResult == COPY_SUCCESS)
+        {
+            copyResult = COPY_WRITE_ERROR;
+        }
+        
+        if(copyResult == COPY_WRITE_ERROR)
+        {
+            fileOpenError(entry->name);
+        }
+        *written = (copyResult == COPY_SUCCESS);
+    }
+    return copyResult;
+}
+
+/* Makes link, an ENTRY_LINK entry of a streamed archive, a hard link to the
+ * extracted file of the entry target. target is NULL if that file wasn't
+ * extracted; its body has gone by, so the link can't be extracted. Prints a
+ * message to stderr if the link can't be made. */
+static void extractStreamLink(dirCache* dirs,
+                              archiveEntry* link,
+                              archiveEntry* target)
+{
+    char* relName; // the name of the link relative to dirFd
+    int dirFd; // the directory that holds the link
+    
+    if(!target)
+    {
+        fileOpenError(link->name);
+        return;
+    }
+    
+    if(ensureParentDir(dirs, link->name, &dirFd, &relName) < 0)
+    {
+        return;
+    }
+    
+    // replace whatever has the link's name, as extracting a file would
+    if(!((unlinkat(dirFd, relName, 0) == 0 || errno == ENOENT) &&
+         linkat(AT_FDCWD, target->name, dirFd, relName, 0) == 0))
+    {
+        fileOpenError(link->name);
+    }
+}
+
+/* Extracts the files named by fileArgs (every file if numFileArgs is 0) from
+ * the streamed archive stream, whose header has been read into index, as
+ * farExtract does, reading the archive once from front to back on this
+ * thread. Only the files written in full are kept in index, since only they
+ * can be linked to by later entries. Closes stream and deletes index.
+ * Returns a code of FAR_RTRN. */
+static FAR_RTRN extractStream(FILE* stream,
+                              archiveIndex* index,
+                              char** fileArgs,
+                              unsigned int numFileArgs)
+{
+    char** slashedFileArgs = NULL; /* holds the strings of fileArgs with a '/'
+                                    * added to the end if it's not already
+                                    * there. Used to compare directory paths */
+    
+    nameSet* argSet = NULL; // a nameSet of fileArgs
+    dirTrie* dirArgs = NULL; // a dirTrie of slashedFileArgs
+    unsigned char* usedArgs = NULL; /* bit i is set if fileArgs[i] or
+                                     * slashedFileArgs[i] caused an
+                                     * extraction */
+    
+    dirCache* dirs = dirCacheNew(); // the directories created or found so far
+    off_t streamEnd = fileLength(stream); // -1 for a pipe
+    char corrupted = 0; // set once the stream is found damaged
+    int readResult = 0; // the result of reading the last entry header
+    
+    if(numFileArgs > 0)
+    {
+        argSet = nameSetNew(fileArgs, numFileArgs);
+        usedArgs = bitmapNew(numFileArgs);
+        
+        // initialize slashedFileArgs
+        slashedFileArgs = malloc(sizeof(char*) * numFileArgs);
+        for(unsigned int i = 0; i < numFileArgs; i++)
+        {
+            slashedFileArgs[i] = ensureSingleSlash(fileArgs[i]);
+        }
+        dirArgs = dirTrieNew(slashedFileArgs, numFileArgs);
+    }
+    
+    while(!corrupted &&
+          (readResult = archiveStreamReadEntryHeader(stream, index)) > 0)
+    {
+        archiveEntry* entry = &(index->entries[index->numEntries - 1]);
+        char written = 0; // set if a regular file was written in full
+        uint64_t size; // the size of the entry's body
+        int copyResult;
+        
+        // extract all files if we weren't passed any fileArgs
+        char shouldExtract = (numFileArgs == 0);
+        
+        if(numFileArgs > 0)
+        {
+            // compare the entry's name to the arguments passed to 'x'
+            int exactMatchIndex = nameSetFind(argSet, entry->name);
+            int directoryMatchIndex = dirTrieMatch(dirArgs, entry->name);
+            
+            // remember which file argument caused this extraction, if one is
+            // to occur
+            if(exactMatchIndex >= 0)
+            {
+                bitmapSet(usedArgs, exactMatchIndex);
+            }
+            else if(directoryMatchIndex >= 0)
+            {
+                bitmapSet(usedArgs, directoryMatchIndex);
+            }
+            
+            shouldExtract = (exactMatchIndex >= 0 || directoryMatchIndex >= 0);
+        }
+        
+        if(entry->flags & ENTRY_LINK)
+        {
+            int target;
+            size = ARCHIVE_LINK_SIZE;
+            copyResult = readStreamLink(stream, index, &target);
+            if(copyResult == COPY_SUCCESS && shouldExtract)
+            {
+                extractStreamLink(dirs, entry,
+                                  (target >= 0) ? &(index->entries[target])
+                                                : NULL);
+            }
+        }
+        else if(shouldExtract)
+        {
+            copyResult = extractStreamFile(stream, streamEnd, dirs, entry,
+                                           &size, &written);
+        }
+        else
+        {
+            copyResult = readStreamBody(stream, streamEnd, entry, NULL, NULL,
+                                        &size);
+        }
+        
+        if(copyResult == COPY_SHORT_READ ||
+           archiveStreamReadTrailer(stream, index, size) < 0)
+        {
+            corrupted = 1;
+        }
+        
+        if(!written)
+        {
+            archiveIndexRemoveLast(index);
+        }
+    }
+    
+    // clean-up
+    fclose(stream);
+    archiveIndexDelete(index);
+    dirCacheDelete(dirs);
+    if(!corrupted && readResult == 0)
+    {
+        // print messages to stderr about unused filename arguments
+        printUnusedArgs(fileArgs, numFileArgs, usedArgs);
+    }
+    if(argSet) nameSetDelete(argSet);
+    if(dirArgs) dirTrieDelete(dirArgs);
+    if(usedArgs) free(usedArgs);
+    if(slashedFileArgs) charArrayDelete(slashedFileArgs, numFileArgs);
+    return (corrupted || readResult < 0) ? corruptedArchiveError() : SUCCESS;
+}
+
+FAR_RTRN farExtract(char* archiveName,
+                    char** fileArgs,
+                    unsigned int numFileArgs)
+{
+    FILE* archive; // the archive from which we are extracting
+    fileMap* map; // archive, mapped for reading when it can be
+    archiveIndex* index; // the entries in archive
+    
+    char** slashedFileArgs = NULL; /* holds the strings of fileArgs with a '/'
+                                    * added to the end if it's not already
+                                    * there. Used to compare directory paths */
+    
+    nameSet* argSet = NULL; // a nameSet of fileArgs
+    dirTrie* dirArgs = NULL; // a dirTrie of slashedFileArgs
+    unsigned char* usedArgs = NULL; /* bit i is set if fileArgs[i] or
+                                     * slashedFileArgs[i] caused an
+                                     * extraction */
+    
+    archive = openArchiveToRead(archiveName);
+    if(!archive)
+    {
+        return invalidArchiveNameError();
+    }
+    
+    // a streamed archive is read from front to back instead
+    index = archiveIndexNew();
+    if(archiveStreamReadHeader(archive, index) == 0)
+    {
+        return extractStream(archive, index, fileArgs, numFileArgs);
+    }
+    archiveIndexDelete(index);
+    
+    // any other archive is read from its index at the end, which a pipe
+    // can't seek to
+    if(lseek(fileno(archive), 0, SEEK_CUR) < 0)
+    {
+        fclose(archive);
+        return pipedArchiveError();
+    }
+    
+    map = fileMapNew(fileno(archive));
+    index = archiveIndexRead(archive, map);
+    if(!index)
+    {
+        fileMapDelete(map);
+        fclose(archive);
+        return corruptedArchiveError();
+    }
+    
+    if(numFileArgs > 0)
+    {
+        argSet = nameSetNew(fileArgs, numFileArgs);
+        usedArgs = bitmapNew(numFileArgs);
+        
+        // initialize slashedFileArgs
+        slashedFileArgs = malloc(sizeof(char*) * numFileArgs);
+        for(unsigned int i = 0; i < numFileArgs; i++)
+        {
+            slashedFileArgs[i] = ensureSingleSlash(fileArgs[i]);
+        }
+        dirArgs = dirTrieNew(slashedFileArgs, numFileArgs);
+    }
+    
+    // this thread walks the index; with more than one thread, a pool of
+    // workers creates the files and writes their bodies
+    extractJob job;
+    job.archiveMap = map;
+    job.dataEnd = index->dataEnd;
+    job.dirs = dirCacheNew();
+    job.written = calloc(index->numEntries + 1, sizeof(char));
+    job.corrupted = 0;
+    pthread_mutex_init(&(job.lock), NULL);
+    threadPool* pool = NULL;
+    if(numThreads > 1)
+    {
+        pool = threadPoolNew(numThreads, numThreads * QUEUE_PER_THREAD);
+    }
+    
+    // links are made once the files they link to are written
+    unsigned char* links = bitmapNew(index->numEntries);
+    
+    // extracting everything reads the bodies from front to back
+    if(numFileArgs == 0)
+    {
+        fileMapAdvise(map, 0, map->length, FILEMAP_SEQUENTIAL);
+    }
+    
+    // go through the entries in archive, extracting all files that should be
+    // extracted
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        archiveEntry* entry = &(index->entries[i]);
+        
+        if(entry->flags & ENTRY_DELETED)
+        {
+            continue;
+        }
+        
+        // extract all files if we weren't passed any fileArgs
+        char shouldExtract = (numFileArgs == 0);
+        
+        if(numFileArgs > 0)
+        {
+            // compare the entry's name to the arguments passed to 'x'
+            int exactMatchIndex = nameSetFind(argSet, entry->name);
+            int directoryMatchIndex = dirTrieMatch(dirArgs, entry->name);
+            
+            // remember which file argument caused this extraction, if one is
+            // to occur
+            if(exactMatchIndex >= 0)
+            {
+                bitmapSet(usedArgs, exactMatchIndex);
+            }
+            else if(directoryMatchIndex >= 0)
+            {
+                bitmapSet(usedArgs, directoryMatchIndex);
+            }
+            
+            shouldExtract = (exactMatchIndex >= 0 || directoryMatchIndex >= 0);
+        }
+        
+        if(!shouldExtract)
+        {
+            continue;
+        }
+        
+        // links are made after the files they link to
+        if(entry->flags & ENTRY_LINK)
+        {
+            bitmapSet(links, i);
+            continue;
+        }
+        
+        // a chosen body is read ahead while earlier ones are written
+        if(numFileArgs > 0)
+        {
+            fileMapAdvise(map, entry->offset, entry->size, FILEMAP_WILLNEED);
+        }
+        
+        // hand the entry to a worker, or extract it here without a pool
+        if(pool)
+        {
+            extractTask* task = malloc(sizeof(extractTask));
+            task->job = &job;
+            task->entry = entry;
+            task->written = &(job.written[i]);
+            threadPoolSubmit(pool, extractFileTask, task);
+        }
+        else
+        {
+            char result = extractFile(job.archiveMap, job.dataEnd, job.dirs,
+                                      entry);
+            if(result < 0)
+            {
+                job.corrupted = 1;
+                break;
+            }
+            job.written[i] = (result > 0);
+        }
+    }
+    
+    // wait for the workers to finish every entry they were handed
+    if(pool)
+    {
+        threadPoolDelete(pool);
+    }
+    
+    for(unsigned int i = 0; !job.corrupted && i < index->numEntries; i++)
+    {
+        if(!bitmapTest(links, i))
+        {
+            continue;
+        }
+        
+        int target = archiveLinkTarget(job.archiveMap->fd, index, i);
+        if(target < 0 ||
+           extractLink(job.archiveMap, job.dataEnd, job.dirs,
+                       &(index->entries[i]), &(index->entries[target]),
+                       job.written[target]) < 0)
+        {
+            job.corrupted = 1;
+        }
+    }
+    free(links);
+    free(job.written);
+    pthread_mutex_destroy(&(job.lock));
+    dirCacheDelete(job.dirs);
+    fileMapDelete(map);
+    
+    if(job.corrupted)
+    {
+        fclose(archive);
+        archiveIndexDelete(index);
+        if(argSet) nameSetDelete(argSet);
+        if(dirArgs) dirTrieDelete(dirArgs);
+        if(usedArgs) free(usedArgs);
+        if(slashedFileArgs) charArrayDelete(slashedFileArgs, numFileArgs);
+        return corruptedArchiveError();
+    }
+    
+    // print messages to stderr about unused filename arguments
+    printUnusedArgs(fileArgs, numFileArgs, usedArgs);
+    
+    // clean-up
+    fclose(archive);
+    archiveIndexDelete(index);
+    if(argSet) nameSetDelete(argSet);
+    if(dirArgs) dirTrieDelete(dirArgs);
+    if(usedArgs) free(usedArgs);
+    if(slashedFileArgs) charArrayDelete(slashedFileArgs, numFileArgs);
+    return SUCCESS;
+}
+
+/*******************************************************************************
+******************************** farDelete *************************************
+*******************************************************************************/
+
+void farSetLazyDelete(char lazy)
+{
+    lazyDelete = lazy;
+}
+
+FAR_RTRN farDelete(char* archiveName,
+                   char** fileArgs,
+                   unsigned int numFileArgs)
+{
+    FILE* oldArchive; // the old archive named archiveName
+    FILE* tempArchive = NULL; // temporary archive that replaces the old
+                              // one; unused when deleting in place
+    char* tempName = NULL; // the name of tempArchive, or NULL if it has none
+    
+    archiveIndex* oldIndex; // the entries in oldArchive
+    archiveIndex* newIndex = NULL; // the entries in tempArchive
+    uint64_t* newOffsets = NULL; // where each copied entry's body went in
+                                 // tempArchive, for links to it
+    
+    char** slashedFileArgs; /* holds the strings of fileArgs with a '/' added
+                             * to the end if it's not already there. Used to
+                             * compare directory names */
+    
+    nameSet* argSet; // a nameSet of fileArgs
+    dirTrie* dirArgs; // a dirTrie of slashedFileArgs
+    unsigned char* usedArgs; /* bit i is set if fileArgs[i] or
+                              * slashedFileArgs[i] caused a deletion */
+    unsigned char* deleted = NULL; // bit i is set if the entry at i in
+                                   // oldIndex is deleted in place
+    char anyDeleted = 0; // set once an entry is deleted
+    
+    // check for no-args
+    if(numFileArgs == 0)
+    {
+        return SUCCESS;
+    }
+    
+    oldArchive = fopen(archiveName, "rb+");
+    if(!oldArchive)
+    {
+        return invalidArchiveNameError();
+    }
+    
+    // read the entries in oldArchive
+    oldIndex = archiveIndexRead(oldArchive, NULL);
+    if(!oldIndex)
+    {
+        FAR_RTRN error = unmodifiableArchiveError(oldArchive);
+        fclose(oldArchive);
+        return error;
+    }
+    
+    // legacy archives have no entry flags, so they're rewritten even in lazy
+    // mode
+    char inPlace = lazyDelete && oldIndex->version == ARCHIVE_VERSION;
+    
+    if(!inPlace)
+    {
+        // open the temp archive and check for error
+        tempArchive = openTempArchive(archiveName, oldArchive, &tempName);
+        if(!tempArchive)
+        {
+            fclose(oldArchive);
+            archiveIndexDelete(oldIndex);
+            return openTempArchiveError();
+        }
+        
+        // the number of files in the header is filled in by finalizeArchive
+        archiveWriteHeader(tempArchive);
+        newIndex = archiveIndexNew();
+        newOffsets = calloc(oldIndex->numEntries + 1, sizeof(uint64_t));
+    }
+    else
+    {
+        deleted = bitmapNew(oldIndex->numEntries);
+    }
+    
+    argSet = nameSetNew(fileArgs, numFileArgs);
+    usedArgs = bitmapNew(numFileArgs);
+    
+    // initialize slashedFileArgs
+    slashedFileArgs = malloc(sizeof(char*) * numFileArgs);
+    for(unsigned int i = 0; i < numFileArgs; i++)
+    {
+        slashedFileArgs[i] = ensureSingleSlash(fileArgs[i]);
+    }
+    dirArgs = dirTrieNew(slashedFileArgs, numFileArgs);
+    
+    // copy oldArchive to tempArchive, not copying any entries that we're
+    // supposed to delete, or flag those entries deleted in oldIndex
+    for(unsigned int i = 0; i < oldIndex->numEntries; i++)
+    {
+        archiveEntry* entry = &(oldIndex->entries[i]);
+        
+        if(entry->flags & ENTRY_DELETED)
+        {
+            continue;
+        }
+        
+        // compare the entry's name to the arguments passed to 'd'
+        int exactMatchIndex = nameSetFind(argSet, entry->name);
+        int directoryMatchIndex = dirTrieMatch(dirArgs, entry->name);
+        
+        // remember which file argument caused this deletion, if a deletion is
+        // to occur
+        if(exactMatchIndex >= 0)
+        {
+            bitmapSet(usedArgs, exactMatchIndex);
+        }
+        else if(directoryMatchIndex >= 0)
+        {
+            bitmapSet(usedArgs, directoryMatchIndex);
+        }
+        
+        char shouldCopy = exactMatchIndex < 0 && directoryMatchIndex < 0;
+        
+        if(inPlace)
+        {
+            if(!shouldCopy)
+            {
+                entry->flags |= ENTRY_DELETED;
+                bitmapSet(deleted, i);
+                anyDeleted = 1;
+            }
+        }
+        else if(shouldCopy)
+        {
+            int copyResult = copyEntry(oldArchive, oldIndex, i, tempArchive,
+                                       newIndex, newOffsets);
+            if(copyResult != COPY_SUCCESS)
+            {
+                fclose(oldArchive);
+                discardTempArchive(tempArchive, tempName);
+                archiveIndexDelete(oldIndex);
+                archiveIndexDelete(newIndex);
+                free(newOffsets);
+                nameSetDelete(argSet);
+                dirTrieDelete(dirArgs);
+                free(usedArgs);
+                charArrayDelete(slashedFileArgs, numFileArgs);
+                return copyEntryError(copyResult);
+            }
+        }
+    }
+    
+    free(newOffsets);
+    
+    // finish and clean-up
+    FAR_RTRN returnCode = SUCCESS;
+    if(inPlace)
+    {
+        // publish the deletions by rewriting the index in place, then mark
+        // the deleted entries' headers
+        if(anyDeleted)
+        {
+            int result = -1;
+            if(fseeko(oldArchive, oldIndex->dataEnd, SEEK_SET) == 0)
+            {
+                result = commitInPlace(oldArchive, oldIndex, deleted);
+            }
+            if(result < 0)
+            {
+                restoreInPlace(oldArchive, oldIndex, oldIndex->numEntries,
+                               oldIndex->numChunks, deleted);
+            }
+            if(result != 0)
+            {
+                returnCode = archiveWriteError();
+            }
+        }
+        fclose(oldArchive);
+    }
+    else
+    {
+        if(finalizeArchive(oldArchive, archiveName, tempArchive, tempName,
+                           newIndex) < 0)
+        {
+            returnCode = openTempArchiveError();
+        }
+        archiveIndexDelete(newIndex);
+    }
+    
+    // determine which elements of fileArgs didn't cause a deletion
+    if(returnCode == SUCCESS)
+    {
+        printUnusedArgs(fileArgs, numFileArgs, usedArgs);
+    }
+    
+    free(deleted);
+    archiveIndexDelete(oldIndex);
+    nameSetDelete(argSet);
+    dirTrieDelete(dirArgs);
+    free(usedArgs);
+    charArrayDelete(slashedFileArgs, numFileArgs);
+    return returnCode;
+}
+
+/*******************************************************************************
+********************************* farBatch *************************************
+*******************************************************************************/
+
+// names that select archive entries, and the directories under which they do
+typedef struct
+{
+    char** names; // the names; not owned by the selection
+    unsigned int numNames; // the number of names
+    char** slashedNames; // names with a single '/' at the end of each
+    nameSet* set; // a nameSet of names
+    dirTrie* dirs; // a dirTrie of slashedNames
+    unsigned char* used; // bit i is set once names[i] selects an entry
+} nameSelection;
+
+/* Initializes selection with the numNames names in names, which must outlive
+ * it */
+static void nameSelectionInit(nameSelection* selection,
+                              char** names,
+                              unsigned int numNames)
+{
+    selection->names = names;
+    selection->numNames = numNames;
+    selection->slashedNames = malloc(sizeof(char*) * (numNames + 1));
+    for(unsigned int i = 0; i < numNames; i++)
+    {
+        selection->slashedNames[i] = ensureSingleSlash(names[i]);
+    }
+    selection->set = nameSetNew(names, numNames);
+    selection->dirs = dirTrieNew(selection->slashedNames, numNames);
+    selection->used = bitmapNew(numNames);
+}
+
+/* Frees what nameSelectionInit allocated for selection, after printing a
+ * message to stderr for each of its names that selected nothing */
+static void nameSelectionFinish(nameSelection* selection)
+{
+    printUnusedArgs(selection->names, selection->numNames, selection->used);
+    nameSetDelete(selection->set);
+    dirTrieDelete(selection->dirs);
+    free(selection->used);
+    charArrayDelete(selection->slashedNames, selection->numNames);
+}
+
+/* Returns the index of the name in selection that selects the entry named
+ * name, either by being name or the name of a directory that it is under, and
+ * marks that name used. Returns -1 if no name selects it. */
+static int nameSelectionMatch(nameSelection* selection, const char* name)
+{
+    int match = nameSetFind(selection->set, name);
+    if(match < 0)
+    {
+        match = dirTrieMatch(selection->dirs, name);
+    }
+    if(match >= 0)
+    {
+        bitmapSet(selection->used, match);
+    }
+    return match;
+}
+
+/* Returns the malloc'd name that the entry named name is given by the rename
+ * at match in renames, as found by nameSelectionMatch, where renameTo[i] is
+ * the new name of renames->names[i], or NULL if match is -1. An entry under a
+ * renamed directory keeps its path below that directory. */
+static char* renamedEntryName(const char* name,
+                              int match,
+                              nameSelection* renames,
+                              char** renameTo)
+{
+    char* newName;
+    
+    if(match < 0)
+    {
+        return NULL;
+    }
+    
+    // an exact match takes the new name as it is
+    if(strcmp(name, renames->names[match]) == 0)
+    {
+        newName = malloc(sizeof(char) * (strlen(renameTo[match]) + 1));
+        strcpy(newName, renameTo[match]);
+        return newName;
+    }
+    
+    const char* rest = name + strlen(renames->slashedNames[match]);
+    newName = malloc(sizeof(char) *
+                     (strlen(renameTo[match]) + strlen(rest) + 2));
+    sprintf(newName, "%s/%s", renameTo[match], rest);
+    return newName;
+}
+
+/* Rewrites the archive named archiveName, which is open as oldArchive with
+ * the entries in oldIndex, or doesn't exist if oldArchive is NULL, with the
+ * batch of changes given by farBatch applied: entries selected by deletes are
+ * dropped, those selected by renames are renamed to the names at the same
+ * indices in renameTo, and the files in validArgs, of which addSet is a
+ * nameSet, are appended. Closes oldArchive. Returns a code of FAR_RTRN. */
+static FAR_RTRN rewriteBatch(char* archiveName,
+                             FILE* oldArchive,
+                             archiveIndex* oldIndex,
+                             fileList* validArgs,
+                             nameSet* addSet,
+                             nameSelection* deletes,
+                             nameSelection* renames,
+                             char** renameTo,
+                             threadPool* compressPool)
+{
+    unsigned int numOldEntries = oldIndex ? oldIndex->numEntries : 0;
+    
+    // newNames[i] is the name that the entry at i in oldIndex is renamed to
+    // by the rename at renameOps[i] in renames, or NULL if it keeps its name.
+    // Bit i of kept is set if the entry isn't deleted.
+    char** newNames = calloc(numOldEntries + 1, sizeof(char*));
+    int* renameOps = malloc(sizeof(int) * (numOldEntries + 1));
+    unsigned char* kept = bitmapNew(numOldEntries);
+    
+    // the names given by renames, which replace entries that already had them
+    char** renamedNames = malloc(sizeof(char*) * (numOldEntries + 1));
+    unsigned int numRenamed = 0;
+    
+    for(unsigned int i = 0; i < numOldEntries; i++)
+    {
+        archiveEntry* entry = &(oldIndex->entries[i]);
+        
+        if(!(entry->flags & ENTRY_DELETED) &&
+           nameSelectionMatch(deletes, entry->name) < 0)
+        {
+            bitmapSet(kept, i);
+            renameOps[i] = nameSelectionMatch(renames, entry->name);
+            newNames[i] = renamedEntryName(entry->name, renameOps[i],
+                                           renames, renameTo);
+            if(newNames[i])
+            {
+                renamedNames[numRenamed++] = newNames[i];
+            }
+        }
+    }
+    nameSet* renamedSet = nameSetNew(renamedNames, numRenamed);
+    
+    // when renames give several entries the same name, the entry renamed by
+    // the later rename keeps it, and the others are dropped as a file with
+    // that name would be. renamedWinners[j] is the index in oldIndex of the
+    // entry that keeps the name renamedNames[j], for the first j of each name.
+    unsigned int* renamedWinners = malloc(sizeof(unsigned int) *
+                                          (numRenamed + 1));
+    for(unsigned int i = 0, j = 0; i < numOldEntries; i++)
+    {
+        if(!newNames[i])
+        {
+            continue;
+        }
+        
+        // newNames[i] is renamedNames[j]
+        int first = nameSetFind(renamedSet, newNames[i]);
+        if((unsigned int)first == j ||
+           renameOps[i] >= renameOps[renamedWinners[first]])
+        {
+            renamedWinners[first] = i;
+        }
+        j++;
+    }
+    
+    // open the temp archive and check for error
+    FILE* tempArchive; // temporary archive that replaces the old one
+    char* tempName; // the name of tempArchive, or NULL if it has none
+    tempArchive = openTempArchive(archiveName, oldArchive, &tempName);
+    if(!tempArchive)
+    {
+        if(oldArchive) fclose(oldArchive);
+        nameSetDelete(renamedSet);
+        free(renamedNames);
+        free(renamedWinners);
+        free(renameOps);
+        charArrayDelete(newNames, numOldEntries);
+        free(kept);
+        return openTempArchiveError();
+    }
+    
+    // the number of files in the header is filled in by finalizeArchive
+    archiveWriteHeader(tempArchive);
+    archiveIndex* newIndex = archiveIndexNew(); // the entries in tempArchive
+    
+    // where each copied entry's body went in tempArchive, for links to it
+    uint64_t* newOffsets = calloc(numOldEntries + 1, sizeof(uint64_t));
+    
+    FAR_RTRN returnCode = SUCCESS;
+    for(unsigned int i = 0; i < numOldEntries; i++)
+    {
+        archiveEntry* entry = &(oldIndex->entries[i]);
+        char* oldName = entry->name;
+        
+        // skip deleted entries, entries whose names are taken by a renamed
+        // entry, and entries that are being replaced
+        if(!bitmapTest(kept, i) ||
+           (!newNames[i] && nameSetFind(renamedSet, entry->name) >= 0) ||
+           (newNames[i] &&
+            renamedWinners[nameSetFind(renamedSet, newNames[i])] != i))
+        {
+            continue;
+        }
+        
+        // the entry is copied under its new name
+        if(newNames[i])
+        {
+            entry->name = newNames[i];
+        }
+        int copyResult = entryReplaced(entry, addSet, NULL) ? COPY_SUCCESS :
+                         copyEntry(oldArchive, oldIndex, i, tempArchive,
+                                   newIndex, newOffsets);
+        entry->name = oldName;
+        
+        if(copyResult != COPY_SUCCESS)
+        {
+            returnCode = copyEntryError(copyResult);
+            break;
+        }
+    }
+    
+    free(newOffsets);
+    nameSetDelete(renamedSet);
+    free(renamedNames);
+    free(renamedWinners);
+    free(renameOps);
+    charArrayDelete(newNames, numOldEntries);
+    free(kept);
+    
+    if(returnCode != SUCCESS)
+    {
+        if(oldArchive) fclose(oldArchive);
+        discardTempArchive(tempArchive, tempName);
+        archiveIndexDelete(newIndex);
+        return returnCode;
+    }
+    
+    // append new files to the end of tempArchive
+    if(appendFiles(tempArchive, newIndex, validArgs, addSet, NULL,
+                   compressPool) < 0)
+    {
+        if(oldArchive) fclose(oldArchive);
+        discardTempArchive(tempArchive, tempName);
+        returnCode = archiveWriteError();
+    }
+    else if(finalizeArchive(oldArchive, archiveName, tempArchive, tempName,
+                            newIndex) < 0)
+    {
+        returnCode = openTempArchiveError();
+    }
+    archiveIndexDelete(newIndex);
+    return returnCode;
+}
+
+FAR_RTRN farBatch(char* archiveName,
+                  char** addArgs,
+                  unsigned int numAddArgs,
+                  char** deleteArgs,
+                  unsigned int numDeleteArgs,
+                  char** renameFrom,
+                  char** renameTo,
+                  unsigned int numRenames)
+{
+    FILE* oldArchive; // the archive file named archiveName
+    archiveIndex* oldIndex = NULL; // the entries in oldArchive
+    
+    nameSelection deletes; // the names of the entries to delete
+    nameSelection renames; // the names of the entries to rename
+    
+    // check for no-args
+    if(numAddArgs == 0 && numDeleteArgs == 0 && numRenames == 0)
     {
-        // count chars in filename up to the next slash, and include the slash
-        currentLen += strcspn(&(filename[currentLen]), "/") + 1;
-        
-        currentStr = malloc(sizeof(char) * (currentLen + 1));
-        
-        strncpy(currentStr, filename, currentLen);
-        currentStr[currentLen] = '\0';
-        
-        if(currentStr[currentLen - 1] == '/') // if it's a directory
-        {
-            ensureDirExists(currentStr);
-        }
-        else // it's a regular file
+        return SUCCESS;
+    }
+    
+    oldArchive = fopen(archiveName, "rb");
+    
+    // read the entries in oldArchive
+    if(oldArchive)
+    {
+        oldIndex = archiveIndexRead(oldArchive, NULL);
+        if(!oldIndex)
         {
-            FILE* extractedFile = fopen(filename, "wb+");
-            
-            if(extractedFile)
-            {
-                for(unsigned int i = 0; i < fileSize; i++)
-                {
-                    int c = fgetc(archive);
-                    if(c == EOF)
-                    {
-                        return -1;
-                    }
-                    else
-                    {
-                        fputc(c, extractedFile);
-                    }
-                }
-                fclose(extractedFile);
-            }
-            else
-            {
-                fileOpenError(filename);
-            }
+            FAR_RTRN error = unmodifiableArchiveError(oldArchive);
+            fclose(oldArchive);
+            return error;
         }
     }
     
-    if(currentStr) free(currentStr);
-    return 0;
+    /* eliminates invalid args (and prints errors) and expands directories to
+     * include their contents */
+    fileList* validArgs = fileListNew(addArgs, numAddArgs, numThreads);
+    nameSet* addSet = nameSetNew(validArgs->names, validArgs->numNames);
+    
+    // the threads that compress the blocks of each file
+    threadPool* compressPool = NULL;
+    if(compressor && !dedup && numThreads > 1)
+    {
+        compressPool = threadPoolNew(numThreads,
+                                     numThreads * QUEUE_PER_THREAD);
+    }
+    
+    nameSelectionInit(&deletes, deleteArgs, numDeleteArgs);
+    nameSelectionInit(&renames, renameFrom, numRenames);
+    
+    FAR_RTRN returnCode = rewriteBatch(archiveName, oldArchive, oldIndex,
+                                       validArgs, addSet, &deletes, &renames,
+                                       renameTo, compressPool);
+    
+    // clean-up
+    nameSelectionFinish(&deletes);
+    nameSelectionFinish(&renames);
+    if(oldIndex) archiveIndexDelete(oldIndex);
+    nameSetDelete(addSet);
+    fileListDelete(validArgs);
+    if(compressPool) threadPoolDelete(compressPool);
+    return returnCode;
 }
 
-FAR_RTRN farExtract(char* archiveName,
-                    char** fileArgs,
-                    unsigned char numFileArgs)
+/*******************************************************************************
+******************************** farCompact ************************************
+*******************************************************************************/
+
+FAR_RTRN farCompact(char* archiveName, unsigned int threshold)
 {
-    FILE* archive; // the archive from which we are extracting
-    unsigned int numFiles; // the number of files in archive
-    
-    charBuffer* filename; // the name of a file read from archive
-    unsigned int fileSize; // the size of a file read from archive
+    FILE* oldArchive; // the archive named archiveName
+    FILE* tempArchive; // temporary archive that replaces the old one
+    char* tempName; // the name of tempArchive, or NULL if it has none
     
-    char** slashedFileArgs = NULL; /* holds the strings of fileArgs with a '/'
-                                    * added to the end if it's not already
-                                    * there. Used to compare directory paths */
+    archiveIndex* oldIndex; // the entries in oldArchive
+    archiveIndex* newIndex; // the entries in tempArchive
     
-    unsigned int* usedArgs = NULL; /* holds the indicies of entries in fileArgs
-                                    * and slashedFileArgs that caused
-                                    * extractions */
-    unsigned int numUsedArgs = 0; // the number of elements in usedArgs
+    unsigned int numDeleted; // the number of deleted entries in oldArchive
     
-    archive = fopen(archiveName, "rb");
-    if(!archive)
+    oldArchive = fopen(archiveName, "rb");
+    if(!oldArchive)
     {
         return invalidArchiveNameError();
     }
-    else if(fread(&numFiles, sizeof(unsigned int), 1, archive) < 1)
+    
+    oldIndex = archiveIndexRead(oldArchive, NULL);
+    if(!oldIndex)
     {
-        fclose(archive);
-        return corruptedArchiveError();
+        FAR_RTRN error = unmodifiableArchiveError(oldArchive);
+        fclose(oldArchive);
+        return error;
     }
     
-    if(numFileArgs > 0)
+    // leave the archive alone until enough of it is dead space
+    uint64_t deadSpace = archiveDeadSpace(oldIndex, &numDeleted);
+    off_t archiveLength = fileLength(oldArchive);
+    if(numDeleted == 0 ||
+       archiveLength <= 0 ||
+       deadSpace * 100 < (uint64_t)threshold * archiveLength)
     {
-        // initialize slashedFileArgs
-        slashedFileArgs = malloc(sizeof(char*) * numFileArgs);
-        for(unsigned int i = 0; i < numFileArgs; i++)
+        fclose(oldArchive);
+        archiveIndexDelete(oldIndex);
+        return SUCCESS;
+    }
+    
+    tempArchive = openTempArchive(archiveName, oldArchive, &tempName);
+    if(!tempArchive)
+    {
+        fclose(oldArchive);
+        archiveIndexDelete(oldIndex);
+        return openTempArchiveError();
+    }
+    
+    // the number of files in the header is filled in by finalizeArchive
+    archiveWriteHeader(tempArchive);
+    newIndex = archiveIndexNew();
+    
+    // where each copied entry's body went in tempArchive, for links to it
+    uint64_t* newOffsets = calloc(oldIndex->numEntries + 1, sizeof(uint64_t));
+    
+    // copy every entry that hasn't been deleted
+    for(unsigned int i = 0; i < oldIndex->numEntries; i++)
+    {
+        archiveEntry* entry = &(oldIndex->entries[i]);
+        
+        if(entry->flags & ENTRY_DELETED)
         {
-            slashedFileArgs[i] = ensureSingleSlash(fileArgs[i]);
+            continue;
+        }
+        
+        int copyResult = copyEntry(oldArchive, oldIndex, i, tempArchive,
+                                   newIndex, newOffsets);
+        if(copyResult != COPY_SUCCESS)
+        {
+            fclose(oldArchive);
+            discardTempArchive(tempArchive, tempName);
+            archiveIndexDelete(oldIndex);
+            archiveIndexDelete(newIndex);
+            free(newOffsets);
+            return copyEntryError(copyResult);
         }
     }
+    free(newOffsets);
+    
+    FAR_RTRN returnCode = SUCCESS;
+    if(finalizeArchive(oldArchive, archiveName, tempArchive, tempName,
+                       newIndex) < 0)
+    {
+        returnCode = openTempArchiveError();
+    }
+    archiveIndexDelete(oldIndex);
+    archiveIndexDelete(newIndex);
+    return returnCode;
+}
+
+/*******************************************************************************
+********************************* farVerify ************************************
+*******************************************************************************/
+
+// results of verifying an entry
+#define VERIFY_OK (0) // the file matches its checksum, or has no contents
+#define VERIFY_DAMAGED (1) // the file doesn't match or can't be read back
+#define VERIFY_UNCHECKED (2) // the file reads back but has no checksum
+
+// the state shared by the worker threads of one verification
+typedef struct
+{
+    const fileMap* archiveMap; // the archive being verified
+    archiveIndex* index; // the entries in the archive
+    char* results; // results[i] is the VERIFY_ result of entry i
+} verifyJob;
+
+// one entry for a worker thread to verify
+typedef struct
+{
+    verifyJob* job; // the verification the entry belongs to
+    unsigned int entryIndex; // the entry to verify
+} verifyTask;
+
+/* Reads back the file held by the entry at entryIndex in index from the
+ * archive read through archiveMap, decompressing or reassembling it as
+ * extracting it would, and checks it against the entry's checksum. Reads
+ * only from the mapping or with positional reads, so several threads may
+ * verify entries of the same archive at once. Returns a VERIFY_ result. */
+static char verifyEntry(const fileMap* archiveMap,
+                        archiveIndex* index,
+                        unsigned int entryIndex)
+{
+    archiveEntry* entry = &(index->entries[entryIndex]);
+    uint32_t checksum = CRC32C_INIT;
+    int copyResult;
+    
+    // only the link itself is checked; see farVerify
+    if(entry->flags & ENTRY_LINK)
+    {
+        return (archiveLinkTarget(archiveMap->fd, index, entryIndex) < 0) ?
+               VERIFY_DAMAGED : VERIFY_OK;
+    }
+    
+    if(entry->codec == CODEC_NONE)
+    {
+        copyResult = fileMapChecksumRange(archiveMap, entry->offset,
+                                          entry->size, &checksum);
+    }
+    else if(entry->codec == CODEC_DEDUP)
+    {
+        copyResult = dedupExtractRange(archiveMap, index->dataEnd, entry, -1,
+                                       &checksum);
+    }
+    else if(codecFind(entry->codec))
+    {
+        copyResult = codecDecompressRange(codecFind(entry->codec), archiveMap,
+                                          entry->offset, entry->size, -1,
+                                          entry->originalSize, &checksum);
+    }
+    else
+    {
+        copyResult = COPY_SHORT_READ; // an unknown codec
+    }
+    
+    if(copyResult != COPY_SUCCESS)
+    {
+        return VERIFY_DAMAGED;
+    }
+    else if(!(entry->flags & ENTRY_CHECKSUMMED))
+    {
+        // directories have nothing to check
+        size_t nameLen = strlen(entry->name);
+        return (nameLen > 0 && entry->name[nameLen - 1] == '/') ?
+               VERIFY_OK : VERIFY_UNCHECKED;
+    }
+    return (checksum == entry->checksum) ? VERIFY_OK : VERIFY_DAMAGED;
+}
+
+/* A threadPoolTask that verifies one entry. Frees its verifyTask. */
+static void verifyEntryTask(void* taskArg)
+{
+    verifyTask* task = taskArg;
+    verifyJob* job = task->job;
     
-    filename = charBufferNew();
+    job->results[task->entryIndex] = verifyEntry(job->archiveMap, job->index,
+                                                 task->entryIndex);
+    free(task);
+}
+
+/* Prints the number of entries that farVerify found intact, damaged and
+ * without checksums to stdout */
+static void printVerifySummary(unsigned int numChecked,
+                               unsigned int numDamaged,
+                               unsigned int numUnchecked)
+{
+    printf("%u entries OK, %u damaged", numChecked, numDamaged);
+    if(numUnchecked > 0)
+    {
+        printf(", %u without checksums", numUnchecked);
+    }
+    printf("\n");
+}
+
+/* Verifies every entry of the streamed archive stream, whose header has been
+ * read into index, as farVerify does, reading the archive once from front to
+ * back on this thread. Only the files that aren't damaged are kept in index,
+ * so a link to a damaged file can't find it and is damaged too. Closes
+ * stream and deletes index. Returns a code of FAR_RTRN. */
+static FAR_RTRN verifyStream(FILE* stream, archiveIndex* index)
+{
+    off_t streamEnd = fileLength(stream); // -1 for a pipe
+    char corrupted = 0; // set once the stream can't be read any further
+    int readResult = 0; // the result of reading the last entry header
+    unsigned int numChecked = 0;
+    unsigned int numDamaged = 0;
+    unsigned int numUnchecked = 0;
     
-    // move through archive, extracting all files that should be extracted
-    for(unsigned int i = 0; i < numFiles; i++)
+    while(!corrupted &&
+          (readResult = archiveStreamReadEntryHeader(stream, index)) > 0)
     {
-        // get filename and fileSize
-        if(getFileName(archive, filename) ||
-           fread(&fileSize, sizeof(unsigned int), 1, archive) < 1)
+        archiveEntry* entry = &(index->entries[index->numEntries - 1]);
+        uint32_t checksum = CRC32C_INIT;
+        uint64_t size; // the size of the entry's body
+        int target = -1; // the file that a link links to
+        int copyResult;
+        char result;
+        
+        if(entry->flags & ENTRY_LINK)
         {
-            // failure
-            fclose(archive);
-            charBufferDelete(filename);
-            if(slashedFileArgs) charArrayDelete(slashedFileArgs, numFileArgs);
-            return corruptedArchiveError();
+            size = ARCHIVE_LINK_SIZE;
+            copyResult = readStreamLink(stream, index, &target);
         }
-        
-        // extract all files if we weren't passed any fileArgs
-        if(numFileArgs == 0)
+        else
         {
-            if(extractFile(archive, filename->str, fileSize) < 0)
-            {
-                // corrupted archive
-                fclose(archive);
-                charBufferDelete(filename);
-                if(slashedFileArgs) charArrayDelete(slashedFileArgs,
-                                                    numFileArgs);
-                return corruptedArchiveError();
-            }
-            continue;
+            copyResult = readStreamBody(stream, streamEnd, entry, NULL,
+                                        &checksum, &size);
         }
         
-        // compare filename to the arguments passed to 'x'
-        int exactMatchIndex = isDuplicateFile(filename->str,
-                                              fileArgs,
-                                              numFileArgs);
-        int directoryMatchIndex = isDirectoryMatch(filename->str,
-                                                   slashedFileArgs,
-                                                   numFileArgs);
+        // a damaged body leaves the rest of the stream unreadable
+        if(copyResult != COPY_SUCCESS ||
+           archiveStreamReadTrailer(stream, index, size) < 0)
+        {
+            corrupted = 1;
+            break;
+        }
         
-        // remember which file argument caused this extraction, if one is
-        // to occur
-        if(exactMatchIndex >= 0)
+        if(entry->flags & ENTRY_LINK)
         {
-            usedArgs = uintArrayAdd(usedArgs, numUsedArgs, exactMatchIndex);
-            numUsedArgs++;
+            result = (target < 0) ? VERIFY_DAMAGED : VERIFY_OK;
         }
-        else if(directoryMatchIndex >= 0)
+        else if(!(entry->flags & ENTRY_CHECKSUMMED))
+        {
+            // directories have nothing to check
+            size_t nameLen = strlen(entry->name);
+            result = (nameLen > 0 && entry->name[nameLen - 1] == '/') ?
+                     VERIFY_OK : VERIFY_UNCHECKED;
+        }
+        else
         {
-            usedArgs = uintArrayAdd(usedArgs, numUsedArgs, directoryMatchIndex);
-            numUsedArgs++;
+            result = (checksum == entry->checksum) ? VERIFY_OK
+                                                   : VERIFY_DAMAGED;
         }
         
-        if(exactMatchIndex >= 0 || directoryMatchIndex >= 0)
+        switch(result)
         {
-            if(extractFile(archive, filename->str, fileSize) < 0)
-            {
-                // corrupted archive
-                fclose(archive);
-                charBufferDelete(filename);
-                if(slashedFileArgs) charArrayDelete(slashedFileArgs,
-                                                    numFileArgs);
-                return corruptedArchiveError();
-            }
+            case VERIFY_DAMAGED:
+                printf("Damaged file: %s\n", entry->name);
+                numDamaged++;
+                break;
+            case VERIFY_UNCHECKED:
+                numUnchecked++;
+                break;
+            default:
+                numChecked++;
+                break;
         }
-        else
+        
+        if(result == VERIFY_DAMAGED || (entry->flags & ENTRY_LINK))
         {
-            // move past file body without extracting
-            for(unsigned int j = 0; j < fileSize; j++)
-            {
-                int c = fgetc(archive);
-                if(c == EOF)
-                {
-                    // unexpected EOF; corrupted archive
-                    fclose(archive);
-                    charBufferDelete(filename);
-                    if(slashedFileArgs) charArrayDelete(slashedFileArgs,
-                                                        numFileArgs);
-                    return corruptedArchiveError();
-                }
-            }
+            archiveIndexRemoveLast(index);
         }
     }
     
-    // print messages to stderr about unused filename arguments
-    printUnusedArgs(fileArgs, numFileArgs, usedArgs, numUsedArgs);
+    fclose(stream);
+    archiveIndexDelete(index);
+    if(corrupted || readResult < 0)
+    {
+        return corruptedArchiveError();
+    }
     
-    // clean-up
-    fclose(archive);
-    charBufferDelete(filename);
-    if(slashedFileArgs) charArrayDelete(slashedFileArgs, numFileArgs);
-    return SUCCESS;
+    printVerifySummary(numChecked, numDamaged, numUnchecked);
+    return (numDamaged > 0) ? CORRUPTED_ARCH : SUCCESS;
 }
 
-/*******************************************************************************
-******************************** farDelete *************************************
-*******************************************************************************/
-
-FAR_RTRN farDelete(char* archiveName,
-                   char** fileArgs,
-                   unsigned char numFileArgs)
+FAR_RTRN farVerify(char* archiveName)
 {
-    FILE* oldArchive; // the old archive named archiveName
-    FILE* tempArchive; // temporary archive that's renamed to archiveName
-    
-    unsigned int oldNumFiles; // number of files in oldArchive
-    unsigned int newNumFiles = 0; // number of files in tempArchive
-    
-    charBuffer* filename; // the name of a file being copied from oldArchive
-    unsigned int fileSize; // the size of the current file in oldArchive
-    
-    char** slashedFileArgs; /* holds the strings of fileArgs with a '/' added
-                             * to the end if it's not already there. Used to
-                             * compare directory names */
-    
-    unsigned int* usedArgs = NULL; /* holds indicies of entries in fileArgs and
-                                    * slashedFileArgs that caused deletions */
-    unsigned int numUsedArgs = 0; // the number of elements in usedArgs
+    FILE* archive; // the archive file named archiveName
+    fileMap* map; // archive, mapped for reading when it can be
+    archiveIndex* index; // the entries in archive
     
-    // check for no-args
-    if(numFileArgs == 0)
+    archive = openArchiveToRead(archiveName);
+    if(!archive)
     {
-        return SUCCESS;
+        return invalidArchiveNameError();
     }
     
-    // initialize slashedFileArgs
-    slashedFileArgs = malloc(sizeof(char*) * numFileArgs);
-    for(unsigned int i = 0; i < numFileArgs; i++)
+    // a streamed archive is read from front to back instead
+    index = archiveIndexNew();
+    if(archiveStreamReadHeader(archive, index) == 0)
     {
-        slashedFileArgs[i] = ensureSingleSlash(fileArgs[i]);
+        return verifyStream(archive, index);
     }
+    archiveIndexDelete(index);
     
-    oldArchive = fopen(archiveName, "rb+");
-    
-    // read the number of files in oldArchive
-    if(oldArchive)
-    {
-        if(fread(&oldNumFiles, sizeof(unsigned int), 1, oldArchive) < 1)
-        {
-            fclose(oldArchive);
-            charArrayDelete(slashedFileArgs, numFileArgs);
-            return corruptedArchiveError();
-        }
-    }
-    else
+    // any other archive is read from its index at the end, which a pipe
+    // can't seek to
+    if(lseek(fileno(archive), 0, SEEK_CUR) < 0)
     {
-        charArrayDelete(slashedFileArgs, numFileArgs);
-        return invalidArchiveNameError();
+        fclose(archive);
+        return pipedArchiveError();
     }
     
-    // open the temp archive and check for error
-    tempArchive = fopen(TEMP_ARCHIVE_NAME, "wb+");
-    if(!tempArchive)
+    map = fileMapNew(fileno(archive));
+    index = archiveIndexRead(archive, map);
+    if(!index)
     {
-        fclose(oldArchive);
-        charArrayDelete(slashedFileArgs, numFileArgs);
-        return openTempArchiveError();
+        fileMapDelete(map);
+        fclose(archive);
+        return corruptedArchiveError();
     }
     
-    // write newNumFiles simply to reserve the uint space;
-    // it will be overwritten at the end
-    fwrite(&newNumFiles, sizeof(unsigned int), 1, tempArchive);
+    // every body is read, from front to back
+    fileMapAdvise(map, 0, map->length, FILEMAP_SEQUENTIAL);
     
-    filename = charBufferNew();
+    verifyJob job;
+    job.archiveMap = map;
+    job.index = index;
+    job.results = calloc(index->numEntries + 1, sizeof(char));
     
-    // copy oldArchive to tempArchive, not copying any entries that we're
-    // supposed to delete
-    for(unsigned int i = 0; i < oldNumFiles; i++)
+    // with more than one thread, a pool of workers checks the entries while
+    // this thread hands them out
+    threadPool* pool = NULL;
+    if(numThreads > 1)
+    {
+        pool = threadPoolNew(numThreads, numThreads * QUEUE_PER_THREAD);
+    }
+    
+    for(unsigned int i = 0; i < index->numEntries; i++)
     {
-        // get filename and fileSize
-        if(getFileName(oldArchive, filename) ||
-           fread(&fileSize, sizeof(unsigned int), 1, oldArchive) < 1)
+        if(index->entries[i].flags & ENTRY_DELETED)
         {
-            fclose(oldArchive);
-            fclose(tempArchive);
-            unlink(TEMP_ARCHIVE_NAME);
-            charBufferDelete(filename);
-            if(usedArgs) free(usedArgs);
-            charArrayDelete(slashedFileArgs, numFileArgs);
-            return corruptedArchiveError();
-        }
-        
-        // compare filename to the arguments passed to 'd'
-        int exactMatchIndex = isDuplicateFile(filename->str,
-                                              fileArgs,
-                                              numFileArgs);
-        int directoryMatchIndex = isDirectoryMatch(filename->str,
-                                                   slashedFileArgs,
-                                                   numFileArgs);
+            continue;
+        }
         
-        // remember which file argument caused this deletion, if a deletion is
-        // to occur
-        if(exactMatchIndex >= 0)
+        if(pool)
         {
-            usedArgs = uintArrayAdd(usedArgs, numUsedArgs, exactMatchIndex);
-            numUsedArgs++;
+            verifyTask* task = malloc(sizeof(verifyTask));
+            task->job = &job;
+            task->entryIndex = i;
+            threadPoolSubmit(pool, verifyEntryTask, task);
         }
-        else if(directoryMatchIndex >= 0)
+        else
         {
-            usedArgs = uintArrayAdd(usedArgs, numUsedArgs, directoryMatchIndex);
-            numUsedArgs++;
+            job.results[i] = verifyEntry(job.archiveMap, index, i);
+        }
+    }
+    
+    // wait for the workers to finish every entry they were handed
+    if(pool)
+    {
+        threadPoolDelete(pool);
+    }
+    
+    // report the damaged files in the order they appear in the archive
+    unsigned int numChecked = 0;
+    unsigned int numDamaged = 0;
+    unsigned int numUnchecked = 0;
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        if(index->entries[i].flags & ENTRY_DELETED)
+        {
+            continue;
         }
         
-        char shouldCopy = exactMatchIndex < 0 && directoryMatchIndex < 0;
-        
-        // write filename and file size
-        if(shouldCopy)
+        // a link is as good as the file it links to, which is only checked
+        // here if it was deleted
+        char result = job.results[i];
+        if((index->entries[i].flags & ENTRY_LINK) && result == VERIFY_OK)
         {
-            fwrite(filename->str,
-                   sizeof(char),
-                   filename->len,
-                   tempArchive);
-            fwrite(&fileSize, sizeof(unsigned int), 1, tempArchive);
-            newNumFiles++;
+            int target = archiveLinkTarget(job.archiveMap->fd, index, i);
+            result = (index->entries[target].flags & ENTRY_DELETED) ?
+                     verifyEntry(job.archiveMap, index, target) :
+                     job.results[target];
         }
         
-        // read file body (and copy to tempArchive if shouldCopy)
-        for(unsigned int j = 0; j < fileSize; j++)
+        switch(result)
         {
-            int c = fgetc(oldArchive);
-            if(c == EOF)
-            {
-                fclose(oldArchive);
-                fclose(tempArchive);
-                unlink(TEMP_ARCHIVE_NAME);
-                charBufferDelete(filename);
-                if(usedArgs) free(usedArgs);
-                charArrayDelete(slashedFileArgs, numFileArgs);
-                return corruptedArchiveError();
-            }
-            else if(shouldCopy)
-            {
-                fputc(c, tempArchive);
-            }
+            case VERIFY_DAMAGED:
+                printf("Damaged file: %s\n", index->entries[i].name);
+                numDamaged++;
+                break;
+            case VERIFY_UNCHECKED:
+                numUnchecked++;
+                break;
+            default:
+                numChecked++;
+                break;
         }
     }
     
-    // determine which elements of fileArgs didn't cause a deletion
-    printUnusedArgs(fileArgs, numFileArgs, usedArgs, numUsedArgs);
+    printVerifySummary(numChecked, numDamaged, numUnchecked);
     
-    // finish and clean-up
-    finalizeArchive(oldArchive, archiveName, tempArchive, newNumFiles);
-    charBufferDelete(filename);
-    if(usedArgs) free(usedArgs);
-    charArrayDelete(slashedFileArgs, numFileArgs);
-    return SUCCESS;
+    free(job.results);
+    archiveIndexDelete(index);
+    fileMapDelete(map);
+    fclose(archive);
+    return (numDamaged > 0) ? CORRUPTED_ARCH : SUCCESS;
 }
 
 /*******************************************************************************
 ********************************* farPrint *************************************
 *******************************************************************************/
 
+/* Prints the original size and name of every entry of the streamed archive
+ * stream, whose header has been read into index, to stdout, reading the
+ * archive once from front to back. The sizes of compressed bodies aren't
+ * known until they've been read, so only original sizes are printed. Closes
+ * stream and deletes index. Returns a code of FAR_RTRN. */
+static FAR_RTRN printStream(FILE* stream, archiveIndex* index)
+{
+    off_t streamEnd = fileLength(stream); // -1 for a pipe
+    int readResult; // the result of reading the last entry header
+    
+    while((readResult = archiveStreamReadEntryHeader(stream, index)) > 0)
+    {
+        archiveEntry* entry = &(index->entries[index->numEntries - 1]);
+        uint64_t size; // the size of the entry's body
+        
+        printf("%8" PRIu64 " %s\n", entry->originalSize, entry->name);
+        
+        if(readStreamBody(stream, streamEnd, entry, NULL, NULL, &size) ==
+               COPY_SHORT_READ ||
+           archiveStreamReadTrailer(stream, index, size) < 0)
+        {
+            readResult = -1;
+            break;
+        }
+        archiveIndexRemoveLast(index);
+    }
+    
+    fclose(stream);
+    archiveIndexDelete(index);
+    return (readResult < 0) ? corruptedArchiveError() : SUCCESS;
+}
+
 FAR_RTRN farPrint(char* archiveName)
 {
     FILE* archive; // the archive file named archiveName
-    unsigned int numFiles; // the number of files in the archive
-    charBuffer* filename; // the current filename being read from archive
-    unsigned int fileSize; // the size of the current file in archive
+    farArchive* opened; // archive, with its index read
+    archiveIndex* index; // the entries in archive
+    unsigned int numDeleted; // the number of deleted entries in archive
     
-    archive = fopen(archiveName, "rb");
+    archive = openArchiveToRead(archiveName);
     
     // check for open file error
     if(!archive)
@@ -829,50 +2901,74 @@ FAR_RTRN farPrint(char* archiveName)
         return invalidArchiveNameError();
     }
     
-    // get number of files in archive
-    if(fread(&numFiles, sizeof(unsigned int), 1, archive) < 1)
+    // a streamed archive is read from front to back instead
+    index = archiveIndexNew();
+    if(archiveStreamReadHeader(archive, index) == 0)
+    {
+        return printStream(archive, index);
+    }
+    archiveIndexDelete(index);
+    
+    // any other archive is read from its index at the end, which a pipe
+    // can't seek to
+    if(lseek(fileno(archive), 0, SEEK_CUR) < 0)
     {
         fclose(archive);
+        return pipedArchiveError();
+    }
+    
+    // read the entries in archive, from its index when it has one, straight
+    // from the mapping
+    FAR_RTRN openResult = farArchiveOpenFile(archive, &opened);
+    if(openResult == CORRUPTED_ARCH)
+    {
         return corruptedArchiveError();
     }
+    else if(openResult != SUCCESS)
+    {
+        return invalidArchiveNameError();
+    }
+    index = opened->index;
     
-    // print name and size of each file to stdout
-    filename = charBufferNew();
-    for(unsigned int i = 0; i < numFiles; i++)
+    // if any file is compressed or a link, the size it takes up in the
+    // archive is printed after its original size
+    char anyCompressed = 0;
+    for(unsigned int i = 0; i < index->numEntries; i++)
     {
-        // copy the filename into the filename charBuffer
-        if(getFileName(archive, filename))
+        if(index->entries[i].codec != CODEC_NONE ||
+           (index->entries[i].flags & ENTRY_LINK))
         {
-            fclose(archive);
-            charBufferDelete(filename);
-            return corruptedArchiveError();
+            anyCompressed = 1;
         }
-        
-        // get size of current file
-        if(fread(&fileSize, sizeof(unsigned int), 1, archive) < 1)
+    }
+    
+    // print name and size of each file to stdout
+    farIterator files;
+    farEntry file;
+    farIteratorInit(&files, opened);
+    while(farIteratorNext(&files, &file))
+    {
+        if(anyCompressed)
         {
-            fclose(archive);
-            charBufferDelete(filename);
-            return corruptedArchiveError();
+            printf("%8" PRIu64 " %8" PRIu64 " %s\n", file.size,
+                   file.storedSize, file.name);
         }
-        
-        printf("%8d %s\n", fileSize, filename->str);
-        
-        // skip the file body
-        for(unsigned int j = 0; j < fileSize; j++)
+        else
         {
-            int c = fgetc(archive);
-            if(c == EOF)
-            {
-                fclose(archive);
-                charBufferDelete(filename);
-                return corruptedArchiveError();
-            }
+            printf("%8" PRIu64 " %s\n", file.storedSize, file.name);
         }
     }
     
+    // report the space that compacting the archive with 'p' would free
+    uint64_t deadSpace = archiveDeadSpace(index, &numDeleted);
+    if(numDeleted > 0)
+    {
+        printf("%8" PRIu64 " bytes reclaimable from %u deleted files\n",
+               deadSpace,
+               numDeleted);
+    }
+    
     // clean-up and return success
-    charBufferDelete(filename);
-    fclose(archive);
+    farArchiveClose(opened);
     return SUCCESS;
-}
\ No newline at end of file
+}
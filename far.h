@@ -16,24 +16,100 @@ typedef enum
     SUCCESS = 0,
     OPEN_ERROR, // failed to open the archive file
     CORRUPTED_ARCH, // the archive file is corrupted
-    TEMP_FILE_ERROR // failed to create the temporary archive file
+    TEMP_FILE_ERROR, // failed to create the temporary archive file
+    WRITE_ERROR = 5 // failed to write the archive in full; main returns 4
+                    // for invalid arguments
 } FAR_RTRN;
 
+/* Sets whether farAdd compresses the files it adds (compress is nonzero) or
+ * stores them as they are (compress is 0, the default). Compressed files are
+ * split into blocks that are compressed by the threads set with
+ * farSetNumThreads, and are decompressed transparently by farExtract. */
+void farSetCompress(char compress);
+
+/* Sets whether farAdd cuts the files it adds into chunks and stores each
+ * distinct chunk only once in the archive (on is nonzero), or stores every
+ * file whole (on is 0, the default). With compression on as well, each chunk
+ * is compressed on its own. farExtract reassembles chunked files
+ * transparently. */
+void farSetDedup(char on);
+
 /* Executes Far's 'r' command to add to an archive.
  * Returns a code as described above. */
-FAR_RTRN farAdd(char* archiveName, char** fileArgs, unsigned char numFileArgs);
+FAR_RTRN farAdd(char* archiveName, char** fileArgs, unsigned int numFileArgs);
+
+/* Executes Far's 'u' command to update an archive. Like farAdd, except that
+ * files archived with the same type, permissions, size and modification time
+ * are left as they are, so only new and changed files are read and copied.
+ * Returns a code as described above. */
+FAR_RTRN farUpdate(char* archiveName,
+                   char** fileArgs,
+                   unsigned int numFileArgs);
+
+/* Executes Far's 'c' command to create a streamed archive, which is written
+ * from front to back without seeking or a temporary file. If archiveName is
+ * "-", the archive is written to stdout. Files are compressed as farAdd does,
+ * but never deduplicated. farExtract, farVerify and farPrint read streamed
+ * archives, also from stdin when given "-".
+ * Returns a code as described above. */
+FAR_RTRN farCreate(char* archiveName,
+                   char** fileArgs,
+                   unsigned int numFileArgs);
+
+/* Sets the number of threads that farExtract uses. With 1, the default, every
+ * file is extracted on the calling thread. With more, the calling thread walks
+ * the archive while that many worker threads create the files and write their
+ * bodies. farAdd reads the directories it's given with as many threads. */
+void farSetNumThreads(unsigned int threads);
 
 /* Executes Far's 'x' command to extract from an archive.
  * Returns a code as described above. */
 FAR_RTRN farExtract(char* archiveName,
                     char** fileArgs,
-                    unsigned char numFileArgs);
+                    unsigned int numFileArgs);
 
 /* Executes Far's 'd' command to delete files from an archive.
  * Returns a code as described above. */
 FAR_RTRN farDelete(char* archiveName,
                    char** fileArgs,
-                   unsigned char numFileArgs);
+                   unsigned int numFileArgs);
+
+/* Sets whether farDelete marks entries as deleted in place (lazy is nonzero)
+ * or rewrites the archive without them (lazy is 0, the default). Entries
+ * deleted in place are skipped by every command, and their space is freed by
+ * farCompact or by the next rewrite of the archive. */
+void farSetLazyDelete(char lazy);
+
+/* Executes Far's 'b' command to apply a batch of changes to an archive, which
+ * is created if it doesn't exist, in a single rewrite of it. The entries named
+ * by deleteArgs, or under the directories they name, are deleted. Each entry
+ * named renameFrom[i], or under that directory, is renamed to renameTo[i], or
+ * to the same path under renameTo[i], and replaces any entry that already had
+ * its new name. The files in addArgs are then added as farAdd adds them,
+ * replacing the entries that have their names once renaming is done.
+ * Deletions and renames select entries by their names before the batch.
+ * Returns a code as described above. */
+FAR_RTRN farBatch(char* archiveName,
+                  char** addArgs,
+                  unsigned int numAddArgs,
+                  char** deleteArgs,
+                  unsigned int numDeleteArgs,
+                  char** renameFrom,
+                  char** renameTo,
+                  unsigned int numRenames);
+
+/* Executes Far's 'p' command to compact an archive, rewriting it without its
+ * deleted entries if they take up at least threshold percent of it.
+ * Returns a code as described above. */
+FAR_RTRN farCompact(char* archiveName, unsigned int threshold);
+
+/* Executes Far's 'v' command to check every file in an archive against the
+ * checksum stored when it was added, without extracting anything. Files are
+ * checked by the threads set with farSetNumThreads. Prints the name of each
+ * damaged file, then a summary, to stdout.
+ * Returns CORRUPTED_ARCH if any file is damaged, else a code as described
+ * above. */
+FAR_RTRN farVerify(char* archiveName);
 
 /* Executes Far's 't' command to print the contents of an archive.
  * Returns a code as described above. */
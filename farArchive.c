@@ -0,0 +1,303 @@
+/*
+ * File:   farArchive.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Keeps an archive open with its index parsed, for lookups and reads.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "farArchive.h"
+#include "fileCopy.h"
+#include "codec.h"
+#include "dedup.h"
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Sets *entry to the file held by the entry at entryIndex in archive's
+ * index */
+static void farArchiveFillEntry(const farArchive* archive,
+                                unsigned int entryIndex,
+                                farEntry* entry)
+{
+    const archiveEntry* archived = &(archive->index->entries[entryIndex]);
+    size_t nameLen = strlen(archived->name);
+
+    entry->name = archived->name;
+    entry->size = archived->originalSize;
+    entry->storedSize = archived->size;
+    entry->mode = archived->mode;
+    entry->mtime = archived->mtime;
+    entry->isDir = (nameLen > 0 && archived->name[nameLen - 1] == '/');
+    entry->id = entryIndex;
+}
+
+/* Returns the blockTable of the entry at entryIndex in archive's index, which
+ * is compressed or deduplicated, reading it if it's the entry's first read.
+ * Sets *result to COPY_SUCCESS, or to the error that kept it from being read,
+ * in which case NULL is returned. */
+static const blockTable* farArchiveBlockTable(farArchive* archive,
+                                              unsigned int entryIndex,
+                                              int* result)
+{
+    archiveIndex* index = archive->index;
+    archiveEntry* archived = &(index->entries[entryIndex]);
+    blockTable* table;
+
+    pthread_mutex_lock(&(archive->tablesLock));
+    table = archive->tables[entryIndex];
+    pthread_mutex_unlock(&(archive->tablesLock));
+    *result = COPY_SUCCESS;
+    if(table)
+    {
+        return table;
+    }
+
+    // read without the lock, so reads of other entries aren't held up; if
+    // another thread reads the same table meanwhile, the first one kept wins
+    if(archived->codec == CODEC_DEDUP)
+    {
+        *result = dedupReadChunkTable(archive->map, index->dataEnd, archived,
+                                      &table);
+    }
+    else
+    {
+        *result = codecReadBlockTable(archive->map, archived->offset,
+                                      archived->size, archived->originalSize,
+                                      &table);
+    }
+    if(*result != COPY_SUCCESS)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&(archive->tablesLock));
+    if(archive->tables[entryIndex])
+    {
+        blockTableDelete(table);
+        table = archive->tables[entryIndex];
+    }
+    else
+    {
+        archive->tables[entryIndex] = table;
+    }
+    pthread_mutex_unlock(&(archive->tablesLock));
+    return table;
+}
+
+/* Finds the entries of archive that aren't deleted and builds the lookup of
+ * their names. Returns 0 on success, -1 if memory runs out. */
+static int farArchiveIndexNames(farArchive* archive)
+{
+    archiveIndex* index = archive->index;
+
+    archive->live = malloc(sizeof(unsigned int) * (index->numEntries + 1));
+    archive->names = malloc(sizeof(char*) * (index->numEntries + 1));
+    archive->nameEntries = malloc(sizeof(unsigned int) *
+                                  (index->numEntries + 1));
+    archive->numLive = 0;
+    if(!archive->live || !archive->names || !archive->nameEntries)
+    {
+        return -1;
+    }
+
+    for(unsigned int i = 0; i < index->numEntries; i++)
+    {
+        if(!(index->entries[i].flags & ENTRY_DELETED))
+        {
+            archive->live[archive->numLive++] = i;
+        }
+    }
+
+    for(unsigned int i = 0; i < archive->numLive; i++)
+    {
+        unsigned int entryIndex = archive->live[archive->numLive - 1 - i];
+        archive->names[i] = index->entries[entryIndex].name;
+        archive->nameEntries[i] = entryIndex;
+    }
+
+    archive->nameLookup = nameSetNew(archive->names, archive->numLive);
+    return archive->nameLookup ? 0 : -1;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+FAR_RTRN farArchiveOpen(const char* archiveName, farArchive** archive)
+{
+    FILE* file = fopen(archiveName, "rb");
+
+    if(!file)
+    {
+        return OPEN_ERROR;
+    }
+    return farArchiveOpenFile(file, archive);
+}
+
+FAR_RTRN farArchiveOpenFile(FILE* file, farArchive** archive)
+{
+    farArchive* opened = calloc(1, sizeof(farArchive));
+
+    if(!opened || !(opened->map = fileMapNew(fileno(file))))
+    {
+        free(opened);
+        fclose(file);
+        return OPEN_ERROR;
+    }
+    opened->file = file;
+    pthread_mutex_init(&(opened->tablesLock), NULL);
+
+    // the index is parsed straight from the mapping when there is one
+    opened->index = archiveIndexRead(file, opened->map);
+    if(!opened->index)
+    {
+        farArchiveClose(opened);
+        return CORRUPTED_ARCH;
+    }
+
+    opened->tables = calloc(opened->index->numEntries + 1,
+                            sizeof(blockTable*));
+    if(!opened->tables || farArchiveIndexNames(opened) < 0)
+    {
+        farArchiveClose(opened);
+        return OPEN_ERROR;
+    }
+
+    *archive = opened;
+    return SUCCESS;
+}
+
+void farArchiveClose(farArchive* archive)
+{
+    if(archive->tables)
+    {
+        for(unsigned int i = 0; i < archive->index->numEntries; i++)
+        {
+            if(archive->tables[i]) blockTableDelete(archive->tables[i]);
+        }
+        free(archive->tables);
+    }
+    pthread_mutex_destroy(&(archive->tablesLock));
+    if(archive->nameLookup) nameSetDelete(archive->nameLookup);
+    free(archive->names);
+    free(archive->nameEntries);
+    free(archive->live);
+    if(archive->index) archiveIndexDelete(archive->index);
+    fileMapDelete(archive->map);
+    fclose(archive->file);
+    free(archive);
+}
+
+unsigned int farArchiveNumEntries(const farArchive* archive)
+{
+    return archive->numLive;
+}
+
+int farArchiveFind(farArchive* archive, const char* name, farEntry* entry)
+{
+    int found = nameSetFind(archive->nameLookup, name);
+
+    if(found < 0)
+    {
+        return -1;
+    }
+    farArchiveFillEntry(archive, archive->nameEntries[found], entry);
+    return 0;
+}
+
+ssize_t farArchiveRead(farArchive* archive,
+                       const farEntry* entry,
+                       uint64_t offset,
+                       char* buffer,
+                       size_t len)
+{
+    archiveIndex* index = archive->index;
+    unsigned int entryIndex = entry->id;
+    const blockTable* table;
+    int readResult;
+
+    // a link is read from the body of the file it links to
+    if(index->entries[entryIndex].flags & ENTRY_LINK)
+    {
+        int target = archiveLinkTarget(fileno(archive->file), index,
+                                       entry->id);
+        if(target < 0)
+        {
+            return -1;
+        }
+        entryIndex = target;
+    }
+    archiveEntry* archived = &(index->entries[entryIndex]);
+
+    if(offset >= archived->originalSize)
+    {
+        return 0;
+    }
+    if(len > archived->originalSize - offset)
+    {
+        len = archived->originalSize - offset;
+    }
+
+    if(archived->codec == CODEC_NONE)
+    {
+        const char* data = (offset > archived->size ||
+                            len > archived->size - offset) ? NULL :
+                           fileMapRead(archive->map, buffer, len,
+                                       archived->offset + offset);
+        if(!data)
+        {
+            return -1;
+        }
+        if(data != buffer)
+        {
+            memcpy(buffer, data, len);
+        }
+        return len;
+    }
+    else if(archived->codec != CODEC_DEDUP && !codecFind(archived->codec))
+    {
+        return -1; // an unknown codec
+    }
+
+    table = farArchiveBlockTable(archive, entryIndex, &readResult);
+    if(!table)
+    {
+        return -1;
+    }
+
+    if(archived->codec == CODEC_DEDUP)
+    {
+        readResult = dedupReadAt(archive->map, index->dataEnd, table,
+                                 offset, buffer, len);
+    }
+    else
+    {
+        readResult = codecReadAt(codecFind(archived->codec), archive->map,
+                                 table, offset, buffer, len);
+    }
+
+    return (readResult == COPY_SUCCESS) ? (ssize_t)len : -1;
+}
+
+void farIteratorInit(farIterator* iterator, farArchive* archive)
+{
+    iterator->archive = archive;
+    iterator->next = 0;
+}
+
+int farIteratorNext(farIterator* iterator, farEntry* entry)
+{
+    if(iterator->next >= iterator->archive->numLive)
+    {
+        return 0;
+    }
+    farArchiveFillEntry(iterator->archive,
+                        iterator->archive->live[iterator->next++], entry);
+    return 1;
+}
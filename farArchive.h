@@ -0,0 +1,107 @@
+/*
+ * File:   farArchive.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * An archive held open for lookups, so that programs linking libfar can list
+ * it, find files in it by name and read parts of them without the archive
+ * being opened and parsed again for each request. Nothing is printed; errors
+ * are returned as codes of far.h.
+ */
+
+#ifndef FARARCHIVE_H
+#define FARARCHIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "far.h"
+#include "archive.h"
+#include "codec.h"
+#include "fileMap.h"
+#include "nameSet.h"
+
+typedef struct
+{
+    FILE* file; // the archive file
+    fileMap* map; // file, mapped for reading when it can be
+    archiveIndex* index; // the entries in the archive
+    unsigned int* live; // the indices in index of the entries that aren't
+                        // deleted, in the order they appear
+    unsigned int numLive; // the number of elements in live
+    char** names; // the names of the entries in live, from the last to the
+                  // first, so that a name held by two entries finds the later
+    unsigned int* nameEntries; // nameEntries[i] is the index in index of the
+                               // entry named names[i]
+    nameSet* nameLookup; // a nameSet of names
+    blockTable** tables; // tables[i] is the blockTable of the compressed or
+                         // deduplicated entry at index i in index, read the
+                         // first time the entry is, or NULL until then
+    pthread_mutex_t tablesLock; // guards the elements of tables
+} farArchive;
+
+// a file in a farArchive, as seen by the programs using it
+typedef struct
+{
+    const char* name; // the file's name, which ends in '/' for a directory;
+                      // valid until the archive is closed
+    uint64_t size; // the size in bytes of the file
+    uint64_t storedSize; // the number of bytes its body takes up
+    uint32_t mode; // the file's type and permission bits, or 0 if the
+                   // archive predates them
+    int64_t mtime; // the time the file's contents were last modified, in
+                   // seconds since the epoch
+    char isDir; // 1 if the file is a directory
+    unsigned int id; // identifies the file to farArchiveRead
+} farEntry;
+
+// walks the files in a farArchive in the order they were added
+typedef struct
+{
+    farArchive* archive; // the archive being walked
+    unsigned int next; // the index in archive->live of the next file
+} farIterator;
+
+/* Opens the archive named archiveName and reads its index, setting *archive
+ * to a malloc'd farArchive that keeps it open. Streamed archives, which have
+ * no index, can't be opened.
+ * Returns SUCCESS, OPEN_ERROR or CORRUPTED_ARCH. */
+FAR_RTRN farArchiveOpen(const char* archiveName, farArchive** archive);
+
+/* Like farArchiveOpen, but for the archive already open as file, which the
+ * farArchive takes over; file is closed if it can't be opened as an archive. */
+FAR_RTRN farArchiveOpenFile(FILE* file, farArchive** archive);
+
+// Closes the file of archive and frees archive
+void farArchiveClose(farArchive* archive);
+
+// Returns the number of files in archive
+unsigned int farArchiveNumEntries(const farArchive* archive);
+
+/* Sets *entry to the file named name in archive. A directory is named with a
+ * '/' at the end. Returns 0 on success, -1 if there's no such file. */
+int farArchiveFind(farArchive* archive, const char* name, farEntry* entry);
+
+/* Copies up to len bytes at offset in the file of entry, which was found in
+ * archive, to buffer, decompressing or reassembling only as much of it as
+ * that takes. The first read of a compressed or deduplicated file reads where
+ * all of its blocks or chunks are and keeps that for later reads. Several
+ * threads may read from the same archive at once.
+ * Returns the number of bytes copied, which is less than len only at the end
+ * of the file, or -1 if the file is damaged or memory runs out. */
+ssize_t farArchiveRead(farArchive* archive,
+                       const farEntry* entry,
+                       uint64_t offset,
+                       char* buffer,
+                       size_t len);
+
+// Points iterator at the first file in archive
+void farIteratorInit(farIterator* iterator, farArchive* archive);
+
+/* Sets *entry to the next file of iterator's archive and moves past it.
+ * Returns 1 if there was one, or 0 once every file has been seen. */
+int farIteratorNext(farIterator* iterator, farEntry* entry);
+
+#endif
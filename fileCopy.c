@@ -0,0 +1,378 @@
+/*
+ * File:   fileCopy.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Moves blocks of bytes between open files through a shared, resizable
+ * buffer.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "fileCopy.h"
+#include "crc32c.h"
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+// copy_file_range was added to glibc in 2.27
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
+// may be overridden at compile time, e.g. -DCOPY_BUFFER_SIZE=4194304
+#ifndef COPY_BUFFER_SIZE
+#define COPY_BUFFER_SIZE (1024 * 1024)
+#endif
+
+// copies smaller than this go through the buffer, since flushing and
+// re-seeking the streams costs more than the kernel saves
+#define KERNEL_COPY_THRESHOLD (64 * 1024)
+
+static char* copyBuffer = NULL; // malloc'd lazily by the first copy
+static size_t copyBufferSize = COPY_BUFFER_SIZE; // the size of copyBuffer
+
+/* Copies up to size bytes from src to dst without passing them through
+ * this process, using copy_file_range or else sendfile. Both streams are
+ * left just past the bytes that were copied.
+ * Returns the number of bytes copied, which is less than size if the kernel
+ * can't copy between these files (the rest should go through the buffer) or
+ * src ended early, in which case *srcEnded is set to 1. */
+static uint64_t kernelCopy(FILE* src,
+                           FILE* dst,
+                           uint64_t size,
+                           char* srcEnded)
+{
+    uint64_t numCopied = 0;
+    *srcEnded = 0;
+
+#ifdef __linux__
+    int srcFd = fileno(src);
+    int dstFd = fileno(dst);
+    char useSendfile = 0; // set when copy_file_range isn't supported
+
+    if(fflush(dst) == EOF)
+    {
+        return 0;
+    }
+
+    off_t srcPosition = ftello(src);
+    off_t dstPosition = ftello(dst);
+    if(srcPosition < 0 || dstPosition < 0)
+    {
+        return 0; // pipes go through the buffer
+    }
+
+    while(numCopied < size)
+    {
+        ssize_t result;
+
+        if(!useSendfile)
+        {
+#ifdef HAVE_COPY_FILE_RANGE
+            result = copy_file_range(srcFd, &srcPosition,
+                                     dstFd, &dstPosition,
+                                     size - numCopied, 0);
+            if(result < 0 && numCopied == 0 &&
+               (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                errno == EOPNOTSUPP || errno == EBADF))
+            {
+                useSendfile = 1;
+                continue;
+            }
+#else
+            useSendfile = 1;
+            continue;
+#endif
+        }
+        else
+        {
+            // sendfile writes at the file position of dstFd
+            if(lseek(dstFd, dstPosition, SEEK_SET) < 0)
+            {
+                break;
+            }
+            result = sendfile(dstFd, srcFd, &srcPosition, size - numCopied);
+            if(result > 0)
+            {
+                dstPosition += result;
+            }
+        }
+
+        if(result == 0)
+        {
+            *srcEnded = 1;
+            break;
+        }
+        else if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break; // the kernel can't copy these files; use the buffer
+        }
+        numCopied += result;
+    }
+
+    // move the streams past the copied bytes
+    fseeko(src, srcPosition, SEEK_SET);
+    fseeko(dst, dstPosition, SEEK_SET);
+#endif
+
+    return numCopied;
+}
+
+int fileCopySetBufferSize(size_t size)
+{
+    if(size == 0)
+    {
+        return -1;
+    }
+
+    // the buffer is re-malloc'd with the new size by the next copy
+    free(copyBuffer);
+    copyBuffer = NULL;
+    copyBufferSize = size;
+    return 0;
+}
+
+int fileCopy(FILE* src, FILE* dst, uint64_t size, uint32_t* checksum)
+{
+    int result = COPY_SUCCESS;
+
+    if(!copyBuffer)
+    {
+        copyBuffer = malloc(copyBufferSize);
+        if(!copyBuffer)
+        {
+            return COPY_WRITE_ERROR;
+        }
+    }
+
+    if(dst && !checksum && size >= KERNEL_COPY_THRESHOLD)
+    {
+        char srcEnded;
+        size -= kernelCopy(src, dst, size, &srcEnded);
+        if(srcEnded)
+        {
+            return COPY_SHORT_READ;
+        }
+    }
+
+    while(size > 0)
+    {
+        size_t blockSize = (size < copyBufferSize) ? size : copyBufferSize;
+        size_t numRead = fread(copyBuffer, sizeof(char), blockSize, src);
+        
+        if(checksum)
+        {
+            *checksum = crc32cUpdate(*checksum, copyBuffer, numRead);
+        }
+
+        // stop writing after the first failure, but keep consuming src
+        if(dst && result == COPY_SUCCESS &&
+           fwrite(copyBuffer, sizeof(char), numRead, dst) < numRead)
+        {
+            result = COPY_WRITE_ERROR;
+        }
+
+        if(numRead < blockSize)
+        {
+            return COPY_SHORT_READ;
+        }
+        size -= numRead;
+    }
+
+    return result;
+}
+
+int fileSkip(FILE* src, uint64_t size, off_t fileEnd)
+{
+    off_t position = ftello(src);
+    
+    if(fileEnd < 0 || position < 0)
+    {
+        return fileCopy(src, NULL, size, NULL);
+    }
+    else if(position + size > fileEnd)
+    {
+        return COPY_SHORT_READ; // the file is too short to hold size bytes
+    }
+    else if(fseeko(src, size, SEEK_CUR) < 0)
+    {
+        return COPY_SHORT_READ;
+    }
+    
+    return COPY_SUCCESS;
+}
+
+int fileCopyRange(int srcFd, off_t srcOffset,
+                  int dstFd, off_t dstOffset,
+                  uint64_t size)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+    while(size >= KERNEL_COPY_THRESHOLD)
+    {
+        ssize_t result = copy_file_range(srcFd, &srcOffset,
+                                         dstFd, &dstOffset,
+                                         size, 0);
+        if(result == 0)
+        {
+            return COPY_SHORT_READ;
+        }
+        else if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break; // the kernel can't copy these files; use a buffer
+        }
+        size -= result;
+    }
+#endif
+
+    if(size == 0)
+    {
+        return COPY_SUCCESS;
+    }
+
+    // each caller gets its own buffer so that threads don't share one
+    size_t bufferSize = (size < copyBufferSize) ? size : copyBufferSize;
+    char* buffer = malloc(bufferSize);
+    int result = COPY_SUCCESS;
+
+    if(!buffer)
+    {
+        return COPY_WRITE_ERROR;
+    }
+
+    while(size > 0 && result == COPY_SUCCESS)
+    {
+        size_t blockSize = (size < bufferSize) ? size : bufferSize;
+        ssize_t numRead = pread(srcFd, buffer, blockSize, srcOffset);
+
+        if(numRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if(numRead <= 0)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+
+        for(ssize_t numWritten = 0; numWritten < numRead; )
+        {
+            ssize_t written = pwrite(dstFd, buffer + numWritten,
+                                     numRead - numWritten,
+                                     dstOffset + numWritten);
+            if(written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if(written <= 0)
+            {
+                result = COPY_WRITE_ERROR;
+                break;
+            }
+            numWritten += written;
+        }
+
+        srcOffset += numRead;
+        dstOffset += numRead;
+        size -= numRead;
+    }
+
+    free(buffer);
+    return result;
+}
+
+int fileChecksumRange(int fd, off_t offset, uint64_t size,
+                      uint32_t* checksum)
+{
+    size_t bufferSize = (size < copyBufferSize) ? size : copyBufferSize;
+    char* buffer = malloc(bufferSize + 1);
+    int result = COPY_SUCCESS;
+
+    if(!buffer)
+    {
+        return COPY_WRITE_ERROR;
+    }
+
+    while(size > 0)
+    {
+        size_t blockSize = (size < bufferSize) ? size : bufferSize;
+        if(fileReadAt(fd, buffer, blockSize, offset) < 0)
+        {
+            result = COPY_SHORT_READ;
+            break;
+        }
+        *checksum = crc32cUpdate(*checksum, buffer, blockSize);
+        offset += blockSize;
+        size -= blockSize;
+    }
+
+    free(buffer);
+    return result;
+}
+
+int fileReadAt(int fd, char* buffer, size_t len, off_t offset)
+{
+    while(len > 0)
+    {
+        ssize_t numRead = pread(fd, buffer, len, offset);
+        if(numRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if(numRead <= 0)
+        {
+            return -1;
+        }
+        buffer += numRead;
+        len -= numRead;
+        offset += numRead;
+    }
+    return 0;
+}
+
+int fileWriteAt(int fd, const char* buffer, size_t len, off_t offset)
+{
+    while(len > 0)
+    {
+        ssize_t numWritten = pwrite(fd, buffer, len, offset);
+        if(numWritten < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if(numWritten <= 0)
+        {
+            return -1;
+        }
+        buffer += numWritten;
+        len -= numWritten;
+        offset += numWritten;
+    }
+    return 0;
+}
+
+off_t fileLength(FILE* file)
+{
+    struct stat fileStat;
+    
+    if(fstat(fileno(file), &fileStat) < 0 || !S_ISREG(fileStat.st_mode))
+    {
+        return -1;
+    }
+    return fileStat.st_size;
+}
@@ -0,0 +1,72 @@
+/*
+ * File:   fileCopy.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Moves blocks of bytes between open files through a shared, resizable
+ * buffer. Used for every body copy that Far performs.
+ */
+
+#ifndef FILECOPY_H
+#define FILECOPY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// return codes for fileCopy
+#define COPY_SUCCESS (0)
+#define COPY_SHORT_READ (-1) // src ended before all bytes were read
+#define COPY_WRITE_ERROR (-2) // dst could not be written
+
+/* Sets the size in bytes of the buffer used to move data between files.
+ * Returns 0 on success, -1 if size is zero. */
+int fileCopySetBufferSize(size_t size);
+
+/* Copies size bytes from the current position of src to the current position
+ * of dst in whole blocks. If dst is NULL, the bytes are read and discarded.
+ * If writing to dst fails, the rest of the bytes are still consumed from src
+ * so that src is left at the end of the copied region. If checksum isn't
+ * NULL, the bytes are checksummed into it as they pass through the buffer;
+ * otherwise the kernel may copy them without this process seeing them.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR. */
+int fileCopy(FILE* src, FILE* dst, uint64_t size, uint32_t* checksum);
+
+/* Moves the position of src forward by size bytes without reading them.
+ * fileEnd is the size of src in bytes as returned by fileLength; the skip
+ * fails if it would pass fileEnd. If src can't seek (or fileEnd is negative),
+ * the bytes are read and discarded instead.
+ * Returns COPY_SUCCESS or COPY_SHORT_READ. */
+int fileSkip(FILE* src, uint64_t size, off_t fileEnd);
+
+/* Copies size bytes at srcOffset in the file open as srcFd to dstOffset in
+ * the file open as dstFd with positional reads and writes. Neither file's
+ * position is used or moved, so several threads may copy out of the same
+ * file at once.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR. */
+int fileCopyRange(int srcFd, off_t srcOffset,
+                  int dstFd, off_t dstOffset,
+                  uint64_t size);
+
+/* Checksums the size bytes at offset in the file open as fd into *checksum
+ * with positional reads, so several threads may read the same file at once.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR if there's no
+ * memory for a buffer. */
+int fileChecksumRange(int fd, off_t offset, uint64_t size,
+                      uint32_t* checksum);
+
+/* Reads exactly len bytes at offset in the file open as fd into buffer
+ * without moving its position. Returns 0 on success, -1 if the file ends
+ * first or can't be read. */
+int fileReadAt(int fd, char* buffer, size_t len, off_t offset);
+
+/* Writes the len bytes in buffer at offset in the file open as fd without
+ * moving its position. Returns 0 on success, -1 on failure. */
+int fileWriteAt(int fd, const char* buffer, size_t len, off_t offset);
+
+/* Returns the size in bytes of the open file, or -1 if it has no size (e.g.
+ * it's a pipe). */
+off_t fileLength(FILE* file);
+
+#endif
@@ -10,20 +10,52 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include "fileList.h"
+#include "threadPool.h"
 
 #define INIT_FILELIST_SIZE (10)
 #define FILELIST_GROWTH_FACTOR (2)
 
+// kinds of fileListNode
+#define NODE_SKIPPED (0) // unsupported, like sockets; left out silently
+#define NODE_FILE (1) // a regular file
+#define NODE_DIR (2) // a directory; its contents are its children
+#define NODE_UNREADABLE (3) // can't be found or opened; reported, not added
+
+// a directory's handle, kept open until each of its subdirectories has been
+// opened relative to it
+typedef struct
+{
+    int fd; // the directory's handle
+    unsigned int numWaiting; // subdirectories that haven't been opened yet
+    pthread_mutex_t lock; // guards numWaiting
+} dirHandle;
+
+// a file found while walking the names passed to fileListNew
+typedef struct fileListNode
+{
+    char* name; // the filename; directories that were read end in '/'
+    unsigned int nameStart; // the index in name of its last component
+    dirHandle* parent; // the handle of a directory's parent, or NULL if it
+                       // must be opened by its whole name
+    char kind; // the NODE_ kind of the file
+    fileInfo info; // what's known about a NODE_FILE or NODE_DIR
+    struct fileListNode* children; // a directory's contents, sorted by name
+    unsigned int numChildren; // the number of elements in children
+} fileListNode;
+
 ////////////////////////////// Errors /////////////////////////////////////
 
 /* Called if the file named filename cannot be opened. Prints a message to
  * stderr. */
-void cannotOpenError(const char* filename)
+static void cannotOpenError(const char* filename)
 {
     fprintf(stderr, "Cannot open file: %s\n", filename);
 }
@@ -38,12 +70,25 @@ void unsupportedError(const char* filename)
 
 //////////////////////////// Private functions ///////////////////////////////
 
-/* Returns 0 if there is no file with the given filename, or we don't have
- *      permision to access it.
- * Returns 1 if the filename is a valid regular file name.
- * Returns 2 if the filename is a valid directory name.
- * Returns 3 if the file called filename is unsupported (like sockets) */
-char checkFileType(const char* filename)
+/* Fills in info from the results of a stat call */
+static void fileInfoFromStat(fileInfo* info, const struct stat* fileStat)
+{
+    info->isDir = S_ISDIR(fileStat->st_mode);
+    info->size = info->isDir ? 0 : fileStat->st_size;
+    info->mode = fileStat->st_mode;
+    info->mtime = fileStat->st_mtime;
+    info->device = fileStat->st_dev;
+    info->inode = fileStat->st_ino;
+    info->numLinks = fileStat->st_nlink;
+}
+
+/* Returns 0 if there is no file with the given filename.
+ * Returns 1 if the filename is a regular file name.
+ * Returns 2 if the filename is a directory name.
+ * Returns 3 if the file called filename is unsupported (like sockets)
+ * Fills in info for regular files and directories. Whether the file can be
+ * read is left to the open that reads it. */
+static char checkFileType(const char* filename, fileInfo* info)
 {
     struct stat fileStat;
     
@@ -55,36 +100,15 @@ char checkFileType(const char* filename)
     
     mode_t mode = fileStat.st_mode;
     
-    if(S_ISCHR(mode) || S_ISBLK(mode) || S_ISFIFO(mode) || S_ISLNK(mode) ||
-       S_ISSOCK(mode))
+    if(S_ISREG(mode))
     {
-        return 3;
-    }
-    else if(S_ISREG(mode))
-    {
-        FILE* file = fopen(filename, "rb");
-        if(file)
-        {
-            fclose(file);
-            return 1;
-        }
-        else
-        {
-            return 0;
-        }
+        fileInfoFromStat(info, &fileStat);
+        return 1;
     }
     else if(S_ISDIR(mode))
     {
-        DIR* dir = opendir(filename);
-        if(dir)
-        {
-            closedir(dir);
-            return 2;
-        }
-        else
-        {
-            return 0;
-        }
+        fileInfoFromStat(info, &fileStat);
+        return 2;
     }
     else
     {
@@ -92,30 +116,21 @@ char checkFileType(const char* filename)
     }
 }
 
-/* Grows files->names by FILELIST_GROWTH_FACTOR if it's needed to add another
- * filename */
-void fileListGrow(fileList* files)
+/* Grows files->names and files->infos by FILELIST_GROWTH_FACTOR if it's
+ * needed to add another filename */
+static void fileListGrow(fileList* files)
 {
     if(files->numNames == files->sizeNames)
     {
         files->sizeNames *= FILELIST_GROWTH_FACTOR;
         files->names = realloc(files->names, sizeof(char*) * files->sizeNames);
+        files->infos = realloc(files->infos,
+                               sizeof(fileInfo) * files->sizeNames);
     }
 }
 
-/* Adds the filename to files, growing files->names first if needed */
-void fileListAddName(fileList* files, const char* filename)
-{
-    char* str = malloc(sizeof(char) * (strlen(filename) + 1));
-    strcpy(str, filename);
-    
-    fileListGrow(files); // only grows if it's needed to add another filename
-    files->names[files->numNames] = str;
-    files->numNames++;
-}
-
 /* malloc's a new char* that contains dirExtension appended to dirBase */
-char* appendDir(const char* dirBase, const char* dirExtension)
+static char* appendDir(const char* dirBase, const char* dirExtension)
 {
     unsigned int origLen = strlen(dirBase);
     unsigned int extLen = strlen(dirExtension);
@@ -126,59 +141,264 @@ char* appendDir(const char* dirBase, const char* dirExtension)
     return output;
 }
 
-/* fileListCheckAndAddName is defined later, but it's needed for fileListAddDir,
- * which is called by fileListCheckAndAddName */
-void fileListCheckAndAddName(fileList* files, const char* filename);
+/* Orders fileListNodes by name */
+static int fileListNodeCompare(const void* a, const void* b)
+{
+    return strcmp(((const fileListNode*)a)->name,
+                  ((const fileListNode*)b)->name);
+}
 
-/* Adds the directory named dirname to files, including the contents of
- * dirname */
-void fileListAddDir(fileList* files, const char* dirname)
+/* Marks one more subdirectory of the directory of handle as opened, closing
+ * and freeing handle once none are left */
+static void dirHandleRelease(dirHandle* handle)
 {
-    DIR* dir; // the directory named dirname
-    struct dirent* dirEntry; // the dirent for dir
+    pthread_mutex_lock(&(handle->lock));
+    unsigned int numWaiting = --(handle->numWaiting);
+    pthread_mutex_unlock(&(handle->lock));
     
-    // slashedDirname is added to files and is thus freed when files is freed
-    char* slashedDirname = ensureSingleSlash(dirname);
-    fileListAddName(files, slashedDirname);
+    if(numWaiting == 0)
+    {
+        close(handle->fd);
+        pthread_mutex_destroy(&(handle->lock));
+        free(handle);
+    }
+}
+
+/* A workPoolTask that reads the directory node (of kind NODE_DIR), filling in
+ * its children in order of name and pushing a task for each subdirectory.
+ * The directory is opened relative to its parent's handle, and its entries
+ * are stat'd relative to its own, so long paths aren't resolved again at each
+ * level and renaming an ancestor during the walk doesn't lose the subtree. A
+ * directory's handle is kept only until its subdirectories have been opened.
+ * Entries that readdir reports as directories or unsupported types aren't
+ * stat'd at all; a directory fills in its own info when it's read. If the
+ * directory can't be opened, node becomes NODE_UNREADABLE. */
+static void fileListReadDir(workPool* pool, unsigned int worker, void* item)
+{
+    fileListNode* node = item;
+    struct dirent* dirEntry; // an entry of the directory
+    int dirFd;
+    
+    if(node->parent)
+    {
+        dirFd = openat(node->parent->fd, &(node->name[node->nameStart]),
+                       O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+        dirHandleRelease(node->parent);
+        node->parent = NULL;
+    }
+    else
+    {
+        dirFd = open(node->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    }
+    DIR* dir = (dirFd >= 0) ? fdopendir(dirFd) : NULL;
+    
+    if(!dir)
+    {
+        if(dirFd >= 0) close(dirFd);
+        node->kind = NODE_UNREADABLE;
+        return;
+    }
+    
+    struct stat fileStat;
+    if(fstat(dirFd, &fileStat) == 0)
+    {
+        fileInfoFromStat(&(node->info), &fileStat);
+    }
     
-    dir = opendir(dirname);
+    char* slashedDirname = ensureSingleSlash(node->name);
+    unsigned int slashedLen = strlen(slashedDirname);
+    unsigned int numSubdirs = 0;
+    unsigned int sizeChildren = INIT_FILELIST_SIZE;
+    node->children = malloc(sizeof(fileListNode) * sizeChildren);
     
     while((dirEntry = readdir(dir)) != NULL)
     {
         // we don't want to add the .. or . directories within dir
-        if(strcmp(dirEntry->d_name, ".") != 0 &&
-           strcmp(dirEntry->d_name, "..") != 0)
+        if(strcmp(dirEntry->d_name, ".") == 0 ||
+           strcmp(dirEntry->d_name, "..") == 0)
+        {
+            continue;
+        }
+        
+        char kind;
+        unsigned char type = dirEntry->d_type;
+        
+        if(type == DT_DIR)
+        {
+            kind = NODE_DIR;
+        }
+        else if(type != DT_REG && type != DT_UNKNOWN)
+        {
+            continue; // unsupported, like sockets and links
+        }
+        else if(fstatat(dirFd, dirEntry->d_name, &fileStat,
+                        AT_SYMLINK_NOFOLLOW) < 0)
+        {
+            kind = NODE_UNREADABLE;
+        }
+        else if(S_ISREG(fileStat.st_mode))
+        {
+            kind = NODE_FILE;
+        }
+        else if(S_ISDIR(fileStat.st_mode))
+        {
+            kind = NODE_DIR;
+        }
+        else
+        {
+            continue; // unsupported
+        }
+        
+        if(node->numChildren == sizeChildren)
+        {
+            sizeChildren *= FILELIST_GROWTH_FACTOR;
+            node->children = realloc(node->children,
+                                     sizeof(fileListNode) * sizeChildren);
+        }
+        
+        fileListNode* child = &(node->children[node->numChildren]);
+        child->name = appendDir(slashedDirname, dirEntry->d_name);
+        child->nameStart = slashedLen;
+        child->parent = NULL;
+        child->kind = kind;
+        if(kind == NODE_FILE)
+        {
+            fileInfoFromStat(&(child->info), &fileStat);
+        }
+        else // filled in when the directory is read
         {
-            char* childDirname = appendDir(slashedDirname, dirEntry->d_name);
-            fileListCheckAndAddName(files, childDirname);
-            free(childDirname);
+            memset(&(child->info), 0, sizeof(fileInfo));
+            child->info.isDir = 1;
+            child->info.mode = S_IFDIR;
+        }
+        child->children = NULL;
+        child->numChildren = 0;
+        node->numChildren++;
+        if(kind == NODE_DIR)
+        {
+            numSubdirs++;
+        }
+    }
+    
+    // the subdirectories share a handle of their own that outlives dir; if
+    // there's none to spare, they're opened by their whole names
+    dirHandle* handle = NULL;
+    if(numSubdirs > 0)
+    {
+        handle = malloc(sizeof(dirHandle));
+        if(handle && (handle->fd = dup(dirFd)) < 0)
+        {
+            free(handle);
+            handle = NULL;
+        }
+        else if(handle)
+        {
+            handle->numWaiting = numSubdirs;
+            pthread_mutex_init(&(handle->lock), NULL);
+        }
+    }
+    closedir(dir);
+    
+    // the directory is added to the list with its slash
+    free(node->name);
+    node->name = slashedDirname;
+    
+    // sort the children so the list doesn't depend on readdir's order or on
+    // which worker reads which directory
+    qsort(node->children, node->numChildren, sizeof(fileListNode),
+          fileListNodeCompare);
+    
+    for(unsigned int i = 0; i < node->numChildren; i++)
+    {
+        if(node->children[i].kind == NODE_DIR)
+        {
+            node->children[i].parent = handle;
+            workPoolPush(pool, worker, &(node->children[i]));
         }
     }
 }
 
-/* Checks filename for validity and either adds it (and its contents if a dir)
- * to files or prints a message to stderr. */
-void fileListCheckAndAddName(fileList* files, const char* filename)
+/* Adds node and everything under it to files in order, printing a message to
+ * stderr for each file that can't be opened. Frees node's children and takes
+ * or frees the names in it. */
+static void fileListAddNode(fileList* files, fileListNode* node)
 {
-    char fileType = checkFileType(filename);
-
-    switch(fileType)
+    switch(node->kind)
     {
-        case 0:
-            cannotOpenError(filename);
+        case NODE_UNREADABLE:
+            cannotOpenError(node->name);
+            free(node->name);
             break;
-        case 3:
-            //unsupportedError(filename);
+        
+        case NODE_FILE:
+        case NODE_DIR:
+            fileListGrow(files);
+            files->names[files->numNames] = node->name;
+            files->infos[files->numNames] = node->info;
+            files->infos[files->numNames].firstName = files->numNames;
+            files->numNames++;
             break;
-
-        case 1: // regular file
-            fileListAddName(files, filename);
+        
+        default:
+            free(node->name);
             break;
+    }
+    
+    for(unsigned int i = 0; i < node->numChildren; i++)
+    {
+        fileListAddNode(files, &(node->children[i]));
+    }
+    free(node->children);
+}
 
-        case 2: // directory
-            fileListAddDir(files, filename);
-            break;
+
+/* Returns a hash of the device and inode of info */
+static unsigned int hashInode(const fileInfo* info)
+{
+    uint64_t hash = ((uint64_t)info->device * 0x9E3779B97F4A7C15u) ^
+                    ((uint64_t)info->inode * 0xC2B2AE3D27D4EB4Fu);
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+/* Points the firstName of each regular file in files that has other hard
+ * links at the first name in files for the same device and inode. */
+static void fileListFindLinks(fileList* files)
+{
+    unsigned int numSlots = 1;
+    while(numSlots < files->numNames * 2)
+    {
+        numSlots *= 2;
+    }
+
+    // a hash table of 1 + the index of the first name of each linked file,
+    // or 0 for an empty slot
+    unsigned int* slots = calloc(numSlots, sizeof(unsigned int));
+
+    for(unsigned int i = 0; i < files->numNames; i++)
+    {
+        fileInfo* info = &(files->infos[i]);
+        if(info->isDir || info->numLinks < 2)
+        {
+            continue;
+        }
+
+        unsigned int slot = hashInode(info) & (numSlots - 1);
+        while(slots[slot] != 0)
+        {
+            fileInfo* first = &(files->infos[slots[slot] - 1]);
+            if(first->device == info->device && first->inode == info->inode)
+            {
+                info->firstName = slots[slot] - 1;
+                break;
+            }
+            slot = (slot + 1) & (numSlots - 1);
+        }
+        if(slots[slot] == 0)
+        {
+            slots[slot] = i + 1;
+        }
     }
+    free(slots);
 }
 
 
@@ -212,17 +432,58 @@ char* ensureSingleSlash(const char* dirname)
     return output;
 }
 
-fileList* fileListNew(char** initNames, unsigned int numInitNames)
+fileList* fileListNew(char** initNames,
+                      unsigned int numInitNames,
+                      unsigned int numThreads)
 {
     fileList* files = malloc(sizeof(fileList));
     files->sizeNames = INIT_FILELIST_SIZE;
     files->names = malloc(sizeof(char*) * INIT_FILELIST_SIZE);
+    files->infos = malloc(sizeof(fileInfo) * INIT_FILELIST_SIZE);
     files->numNames = 0;
     
+    // each initName is the root of a tree that the pool fills in
+    fileListNode* roots = malloc(sizeof(fileListNode) * numInitNames);
+    workPool* pool = workPoolNew((numThreads > 0) ? numThreads : 1,
+                                 fileListReadDir);
+    
+    for(unsigned int i = 0; i < numInitNames; i++)
+    {
+        roots[i].name = malloc(sizeof(char) * (strlen(initNames[i]) + 1));
+        strcpy(roots[i].name, initNames[i]);
+        roots[i].nameStart = 0;
+        roots[i].parent = NULL;
+        roots[i].children = NULL;
+        roots[i].numChildren = 0;
+        
+        switch(checkFileType(initNames[i], &(roots[i].info)))
+        {
+            case 0:
+                roots[i].kind = NODE_UNREADABLE;
+                break;
+            case 1: // regular file
+                roots[i].kind = NODE_FILE;
+                break;
+            case 2: // directory
+                roots[i].kind = NODE_DIR;
+                workPoolPush(pool, 0, &(roots[i]));
+                break;
+            default: // unsupported
+                roots[i].kind = NODE_SKIPPED;
+                break;
+        }
+    }
+    
+    workPoolRun(pool);
+    workPoolDelete(pool);
+    
+    // walk the trees in order, so the list is the same for any numThreads
     for(unsigned int i = 0; i < numInitNames; i++)
     {
-        fileListCheckAndAddName(files, initNames[i]);
+        fileListAddNode(files, &(roots[i]));
     }
+    free(roots);
+    fileListFindLinks(files);
     
     return files;
 }
@@ -234,11 +495,13 @@ void fileListDelete(fileList* files)
         free(files->names[i]);
     }
     free(files->names);
+    free(files->infos);
     free(files);
 }
 
 void fileListContract(fileList* files)
 {
     files->names = realloc(files->names, sizeof(char*) * files->numNames);
+    files->infos = realloc(files->infos, sizeof(fileInfo) * files->numNames);
     files->sizeNames = files->numNames;
 }
\ No newline at end of file
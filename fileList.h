@@ -10,24 +10,54 @@
 #ifndef FILELIST_H
 #define FILELIST_H
 
+#include <sys/types.h>
+#include <time.h>
+
+// what the traversal learned about a file, so it needn't be asked again
+typedef struct
+{
+    char isDir; // 1 if the file is a directory, 0 if it's a regular file
+    off_t size; // the size in bytes of a regular file
+    mode_t mode; // the type and permission bits of the file
+    time_t mtime; // the last time the file's contents were modified
+    dev_t device; // the device that holds the file
+    ino_t inode; // the file's inode number on device
+    nlink_t numLinks; // the number of hard links to the file
+    unsigned int firstName; // the index in the list of the first name of
+                            // this regular file, which is its own index
+                            // unless it's a hard link to an earlier name
+} fileInfo;
+
 typedef struct
 {
     char** names; // a list of nul-terminated filenames
+    fileInfo* infos; // infos[i] describes the file named names[i]
     unsigned int numNames; // the number of filenames in names
-    unsigned int sizeNames; // the malloc'd size of names
+    unsigned int sizeNames; // the malloc'd size of names and infos
 } fileList;
 
 /* Creates a fileList and returns a pointer to it. This fileList's names
  * will be initialized using initNames; only valid filenames in initNames are
- * added, and directories are expanded to also include their contents.
+ * added, and directories are expanded to also include their contents, which
+ * follow the directory in order of name. Directories are read by numThreads
+ * threads, and each is opened relative to its parent, whose handle is held
+ * only until its subdirectories have been opened; the list is the same for
+ * any numThreads. Each file is stat'd at most once, and not at all
+ * when readdir reports that it's a directory or an unsupported type. Files
+ * aren't opened, so unreadable regular files are only found when they are.
+ * Names that are hard links to the same file as an earlier name are found by
+ * their device and inode, and their infos point at the first such name.
  * 
  * Prints messages to stderr regarding invalid filenames in initNames. */
-fileList* fileListNew(char** initNames, unsigned int numInitNames);
+fileList* fileListNew(char** initNames,
+                      unsigned int numInitNames,
+                      unsigned int numThreads);
 
 // Frees a fileList
 void fileListDelete(fileList* files);
 
-// Frees any excess space in files->names and updates files->sizeNames
+/* Frees any excess space in files->names and files->infos and updates
+ * files->sizeNames */
 void fileListContract(fileList* files);
 
 /* Returns a malloc'd string equal to dirname with a single / at the end
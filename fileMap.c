@@ -0,0 +1,128 @@
+/*
+ * File:   fileMap.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * Reads a file through a read-only memory mapping of it.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "fileMap.h"
+#include "fileCopy.h"
+#include "crc32c.h"
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Returns nonzero if the len bytes at offset lie inside the mapping of map */
+static char fileMapContains(const fileMap* map, uint64_t offset, uint64_t len)
+{
+    return offset <= map->length && len <= map->length - offset;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+fileMap* fileMapNew(int fd)
+{
+    fileMap* map = malloc(sizeof(fileMap));
+    struct stat fileStat;
+
+    if(!map)
+    {
+        return NULL;
+    }
+
+    map->fd = fd;
+    map->data = NULL;
+    map->length = 0;
+
+    if(fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) &&
+       fileStat.st_size > 0 && (uint64_t)fileStat.st_size <= SIZE_MAX)
+    {
+        void* data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd,
+                          0);
+        if(data != MAP_FAILED)
+        {
+            map->data = data;
+            map->length = fileStat.st_size;
+        }
+    }
+    return map;
+}
+
+void fileMapDelete(fileMap* map)
+{
+    if(map->data)
+    {
+        munmap((void*)map->data, map->length);
+    }
+    free(map);
+}
+
+void fileMapAdvise(const fileMap* map, uint64_t offset, uint64_t len,
+                   int advice)
+{
+    if(!map->data || !fileMapContains(map, offset, len) || len == 0)
+    {
+        return;
+    }
+
+    // madvise takes whole pages
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t start = offset - offset % pageSize;
+    madvise((void*)(map->data + start), len + (offset - start),
+            (advice == FILEMAP_SEQUENTIAL) ? MADV_SEQUENTIAL : MADV_WILLNEED);
+}
+
+const char* fileMapRead(const fileMap* map, char* buffer, size_t len,
+                        uint64_t offset)
+{
+    if(map->data)
+    {
+        return fileMapContains(map, offset, len) ? map->data + offset : NULL;
+    }
+    return (fileReadAt(map->fd, buffer, len, offset) < 0) ? NULL : buffer;
+}
+
+int fileMapCopyRange(const fileMap* map, uint64_t srcOffset,
+                     int dstFd, off_t dstOffset,
+                     uint64_t size)
+{
+    if(!map->data)
+    {
+        return fileCopyRange(map->fd, srcOffset, dstFd, dstOffset, size);
+    }
+    else if(!fileMapContains(map, srcOffset, size))
+    {
+        return COPY_SHORT_READ;
+    }
+
+    if(fileWriteAt(dstFd, map->data + srcOffset, size, dstOffset) < 0)
+    {
+        return COPY_WRITE_ERROR;
+    }
+    return COPY_SUCCESS;
+}
+
+int fileMapChecksumRange(const fileMap* map, uint64_t offset, uint64_t size,
+                         uint32_t* checksum)
+{
+    if(!map->data)
+    {
+        return fileChecksumRange(map->fd, offset, size, checksum);
+    }
+    else if(!fileMapContains(map, offset, size))
+    {
+        return COPY_SHORT_READ;
+    }
+
+    *checksum = crc32cUpdate(*checksum, map->data + offset, size);
+    return COPY_SUCCESS;
+}
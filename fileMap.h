@@ -0,0 +1,65 @@
+/*
+ * File:   fileMap.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * Reads a file through a read-only memory mapping of it, so that its bytes
+ * can be parsed and written out straight from the page cache. When a file
+ * can't be mapped, the same functions fall back to positional reads.
+ */
+
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// how a range of a fileMap is about to be read, for fileMapAdvise
+#define FILEMAP_SEQUENTIAL (0) // in order, from front to back
+#define FILEMAP_WILLNEED (1) // soon, so it should be read ahead now
+
+typedef struct
+{
+    int fd; // the file; read with positional reads if data is NULL
+    const char* data; // the mapped bytes of the file, or NULL if unmapped
+    uint64_t length; // the number of bytes in data
+} fileMap;
+
+/* mallocs a fileMap of the file open as fd, mapping the whole file if it's a
+ * non-empty regular file that can be mapped, and returns a pointer to it.
+ * The file must not shrink while it's mapped. A fileMap of a file that is
+ * still being written should instead be initialized as {fd, NULL, 0}.
+ * Returns NULL upon failure. */
+fileMap* fileMapNew(int fd);
+
+// Unmaps the file of map, which stays open, and frees map
+void fileMapDelete(fileMap* map);
+
+/* Tells the kernel how the len bytes at offset in map are about to be read,
+ * as one of the FILEMAP_ advice values above. Does nothing if map isn't
+ * mapped. */
+void fileMapAdvise(const fileMap* map, uint64_t offset, uint64_t len,
+                   int advice);
+
+/* Returns a pointer to the len bytes at offset in map: into the mapping if
+ * there is one, or else to buffer, which they are read into. Returns NULL if
+ * the file ends first or can't be read. */
+const char* fileMapRead(const fileMap* map, char* buffer, size_t len,
+                        uint64_t offset);
+
+/* Writes the size bytes at srcOffset in map to dstOffset in the file open as
+ * dstFd, straight from the mapping if there is one, or else as fileCopyRange
+ * does. Several threads may copy out of the same map at once.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR. */
+int fileMapCopyRange(const fileMap* map, uint64_t srcOffset,
+                     int dstFd, off_t dstOffset,
+                     uint64_t size);
+
+/* Checksums the size bytes at offset in map into *checksum, as
+ * fileChecksumRange does.
+ * Returns COPY_SUCCESS, COPY_SHORT_READ or COPY_WRITE_ERROR. */
+int fileMapChecksumRange(const fileMap* map, uint64_t offset, uint64_t size,
+                         uint32_t* checksum);
+
+#endif
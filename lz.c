@@ -0,0 +1,253 @@
+/*
+ * File:   lz.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * A fast LZ77 compressor; the block format is described in lz.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "lz.h"
+
+#define LZ_HASH_BITS (14) // the log2 of the number of slots in the match table
+
+// the largest value that fits in a token's 4-bit field
+#define LZ_TOKEN_MAX (15)
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Returns the 4 bytes at p as an integer */
+static uint32_t lzRead32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(uint32_t));
+    return value;
+}
+
+/* Returns the slot in the match table for the 4 bytes sequence */
+static unsigned int lzHash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes the continuation of a token field holding value to dst, advancing
+ * *position. Returns 0 on success, -1 if it doesn't fit in dstLen bytes. */
+static int lzWriteLength(unsigned char* dst, size_t dstLen, size_t* position,
+                         size_t value)
+{
+    if(value < LZ_TOKEN_MAX)
+    {
+        return 0;
+    }
+
+    for(value -= LZ_TOKEN_MAX; ; value -= 255)
+    {
+        if(*position == dstLen)
+        {
+            return -1;
+        }
+        dst[(*position)++] = (value >= 255) ? 255 : value;
+        if(value < 255)
+        {
+            return 0;
+        }
+    }
+}
+
+/* Reads the continuation of a token field that started as value from src,
+ * advancing *position. Returns the whole value, or sets *damaged if src ends
+ * first. */
+static size_t lzReadLength(const unsigned char* src, size_t len,
+                           size_t* position, size_t value, char* damaged)
+{
+    if(value < LZ_TOKEN_MAX)
+    {
+        return value;
+    }
+
+    unsigned char next;
+    do
+    {
+        if(*position == len)
+        {
+            *damaged = 1;
+            return 0;
+        }
+        next = src[(*position)++];
+        value += next;
+    }
+    while(next == 255);
+
+    return value;
+}
+
+/* Writes a sequence of the numLiterals bytes at literals followed by a match
+ * of matchLen bytes at offset (or no match if matchLen is 0) to dst,
+ * advancing *position. Returns 0 on success, -1 if it doesn't fit. */
+static int lzWriteSequence(unsigned char* dst, size_t dstLen, size_t* position,
+                           const unsigned char* literals, size_t numLiterals,
+                           size_t offset, size_t matchLen)
+{
+    size_t matchField = (matchLen > 0) ? matchLen - LZ_MIN_MATCH : 0;
+
+    if(*position == dstLen)
+    {
+        return -1;
+    }
+    dst[(*position)++] =
+        ((numLiterals < LZ_TOKEN_MAX ? numLiterals : LZ_TOKEN_MAX) << 4) |
+        (matchField < LZ_TOKEN_MAX ? matchField : LZ_TOKEN_MAX);
+
+    if(lzWriteLength(dst, dstLen, position, numLiterals) < 0 ||
+       dstLen - *position < numLiterals)
+    {
+        return -1;
+    }
+    memcpy(&(dst[*position]), literals, numLiterals);
+    *position += numLiterals;
+
+    if(matchLen == 0)
+    {
+        return 0;
+    }
+
+    if(dstLen - *position < 2)
+    {
+        return -1;
+    }
+    dst[(*position)++] = offset & 0xFF;
+    dst[(*position)++] = offset >> 8;
+    return lzWriteLength(dst, dstLen, position, matchField);
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+size_t lzCompress(const char* srcChars, size_t len, char* dstChars,
+                  size_t dstLen)
+{
+    const unsigned char* src = (const unsigned char*)srcChars;
+    unsigned char* dst = (unsigned char*)dstChars;
+    size_t position = 0; // the number of bytes written to dst
+    size_t anchor = 0; // the first byte of src not yet written
+    size_t current = 0; // the byte of src being matched
+
+    // 1 + the last position in src of each hashed sequence, or 0
+    uint32_t* table = calloc((size_t)1 << LZ_HASH_BITS, sizeof(uint32_t));
+    if(!table)
+    {
+        return 0;
+    }
+
+    while(len >= LZ_MIN_MATCH && current <= len - LZ_MIN_MATCH)
+    {
+        uint32_t sequence = lzRead32(&(src[current]));
+        unsigned int slot = lzHash(sequence);
+        size_t candidate = table[slot];
+        table[slot] = current + 1;
+
+        if(candidate == 0 || current - (candidate - 1) > LZ_MAX_OFFSET ||
+           lzRead32(&(src[candidate - 1])) != sequence)
+        {
+            // step faster through data that doesn't match
+            current += 1 + ((current - anchor) >> 6);
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t matchLen = LZ_MIN_MATCH;
+        while(current + matchLen < len &&
+              src[match + matchLen] == src[current + matchLen])
+        {
+            matchLen++;
+        }
+
+        if(lzWriteSequence(dst, dstLen, &position, &(src[anchor]),
+                           current - anchor, current - match, matchLen) < 0)
+        {
+            free(table);
+            return 0;
+        }
+
+        current += matchLen;
+        anchor = current;
+    }
+
+    // the rest of src are literals
+    if(lzWriteSequence(dst, dstLen, &position, &(src[anchor]), len - anchor,
+                       0, 0) < 0)
+    {
+        position = 0;
+    }
+
+    free(table);
+    return position;
+}
+
+int lzDecompress(const char* srcChars, size_t len, char* dstChars,
+                 size_t dstLen)
+{
+    const unsigned char* src = (const unsigned char*)srcChars;
+    unsigned char* dst = (unsigned char*)dstChars;
+    size_t position = 0; // the number of bytes read from src
+    size_t written = 0; // the number of bytes written to dst
+    char damaged = 0;
+
+    while(position < len)
+    {
+        unsigned char token = src[position++];
+
+        size_t numLiterals = lzReadLength(src, len, &position, token >> 4,
+                                          &damaged);
+        if(damaged || numLiterals > len - position ||
+           numLiterals > dstLen - written)
+        {
+            return -1;
+        }
+        memcpy(&(dst[written]), &(src[position]), numLiterals);
+        position += numLiterals;
+        written += numLiterals;
+
+        if(position == len) // the last sequence has no match
+        {
+            break;
+        }
+
+        if(len - position < 2)
+        {
+            return -1;
+        }
+        size_t offset = src[position] | (src[position + 1] << 8);
+        position += 2;
+
+        size_t matchLen = lzReadLength(src, len, &position,
+                                       token & LZ_TOKEN_MAX, &damaged) +
+                          LZ_MIN_MATCH;
+        if(damaged || offset == 0 || offset > written ||
+           matchLen > dstLen - written)
+        {
+            return -1;
+        }
+
+        // the match may overlap the bytes it produces, so copy forwards
+        unsigned char* from = &(dst[written - offset]);
+        unsigned char* to = &(dst[written]);
+        if(offset >= matchLen)
+        {
+            memcpy(to, from, matchLen);
+        }
+        else
+        {
+            for(size_t i = 0; i < matchLen; i++)
+            {
+                to[i] = from[i];
+            }
+        }
+        written += matchLen;
+    }
+
+    return (written == dstLen) ? 0 : -1;
+}
@@ -0,0 +1,38 @@
+/*
+ * File:   lz.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * A fast LZ77 compressor for blocks of up to a few megabytes, favouring speed
+ * over ratio.
+ *
+ * A compressed block is a series of sequences, each made of
+ *     a token byte, whose high 4 bits are the number of literals and whose
+ *         low 4 bits are the match length minus LZ_MIN_MATCH; a field of 15
+ *         is continued by bytes that are added to it up to and including the
+ *         first byte that isn't 255
+ *     the literals, copied to the output as they are
+ *     a 2-byte little-endian offset, back from the end of the output, of the
+ *         match to copy, followed by the continuation of the match length
+ * The last sequence ends after its literals and has no match.
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+
+#define LZ_MIN_MATCH (4) // the shortest match that is encoded
+#define LZ_MAX_OFFSET (65535) // the farthest back a match may start
+
+/* Compresses the len bytes at src into dst, which has room for dstLen
+ * bytes. Returns the size of the compressed block, or 0 if it doesn't fit in
+ * dstLen bytes, in which case the block should be stored as it is. */
+size_t lzCompress(const char* src, size_t len, char* dst, size_t dstLen);
+
+/* Decompresses the len-byte block at src into dst, which must come out to
+ * exactly dstLen bytes. Returns 0 on success, -1 if the block is damaged. */
+int lzDecompress(const char* src, size_t len, char* dst, size_t dstLen);
+
+#endif
@@ -8,15 +8,141 @@
  * calls the appropriate functions in other files.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
 #include "far.h"
+#include "fileCopy.h"
+
+// the default percentage of dead space at which 'p' compacts an archive
+#define DEFAULT_COMPACT_THRESHOLD (25)
+
+// the most threads that -j accepts
+#define MAX_THREADS (256)
+
+// the percentage of dead space at which 'p' compacts an archive
+unsigned int compactThreshold = DEFAULT_COMPACT_THRESHOLD;
+
+// the file given by -T to read more filenames from ("-" for stdin), or NULL
+char* manifestName = NULL;
 
 /* Called if Far isn't passed valid arguments. Prints a message to stderr. */
 void invalidArgsError()
 {
-    fprintf(stderr, "Invalid arguments; Far r|x|d|t archive [filename]*\n");
+    fprintf(stderr,
+            "Invalid arguments; Far [-b bytes] [-l] [-c percent] [-j threads] "
+            "[-z] [-s] [-T file] r|u|c|x|d|b|t|p|v archive [filename]*\n");
+}
+
+/* Parses a size argument such as "65536", "64k" or "4M" into *size.
+ * Returns 0 on success, -1 if str isn't a positive size or the size doesn't
+ * fit in a size_t. */
+int parseSize(const char* str, size_t* size)
+{
+    char* end;
+    errno = 0;
+    unsigned long long value = strtoull(str, &end, 10);
+    size_t multiplier = 1;
+    
+    if(end == str || str[0] == '-' || errno == ERANGE)
+    {
+        return -1;
+    }
+    
+    switch(*end)
+    {
+        case 'k': case 'K':
+            multiplier = 1024;
+            end++;
+            break;
+        case 'm': case 'M':
+            multiplier = 1024 * 1024;
+            end++;
+            break;
+    }
+    
+    if(*end != '\0' || value == 0 || value > SIZE_MAX / multiplier)
+    {
+        return -1;
+    }
+    
+    *size = value * multiplier;
+    return 0;
+}
+
+/* Applies the options at the beginning of argv (those starting with '-').
+ * Returns the index in argv of the first non-option argument, or -1 if an
+ * option is invalid. */
+int parseOptions(int argc, char** argv)
+{
+    int i = 1;
+    
+    while(i < argc && argv[i][0] == '-')
+    {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            size_t bufferSize;
+            if(parseSize(argv[i+1], &bufferSize) < 0)
+            {
+                return -1;
+            }
+            fileCopySetBufferSize(bufferSize);
+            i += 2;
+        }
+        else if(strcmp(argv[i], "-l") == 0)
+        {
+            farSetLazyDelete(1);
+            i++;
+        }
+        else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            char* end;
+            long percent = strtol(argv[i+1], &end, 10);
+            if(end == argv[i+1] || *end != '\0' || percent < 0 || percent > 100)
+            {
+                return -1;
+            }
+            compactThreshold = percent;
+            i += 2;
+        }
+        else if(strcmp(argv[i], "-z") == 0)
+        {
+            farSetCompress(1);
+            i++;
+        }
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            farSetDedup(1);
+            i++;
+        }
+        else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            char* end;
+            long threads = strtol(argv[i+1], &end, 10);
+            if(end == argv[i+1] || *end != '\0' || threads < 1 ||
+               threads > MAX_THREADS)
+            {
+                return -1;
+            }
+            farSetNumThreads(threads);
+            i += 2;
+        }
+        else if(strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+        {
+            manifestName = argv[i+1];
+            i += 2;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    
+    return i;
 }
 
 /* Returns a malloc'd array of strings that is identical to names with trailing
@@ -65,6 +191,116 @@ void freeCharArray(char** names, unsigned int numNames)
     free(names);
 }
 
+/* Reads the NUL-separated filenames in the file named manifestName, or in
+ * stdin if it's "-", skipping empty ones. Returns a malloc'd array of the
+ * numArgs strings in args followed by the malloc'd names read, and sets
+ * *numNames to its length. Returns NULL if the file can't be read. */
+char** readManifest(char* manifestName, char** args, unsigned int numArgs,
+                    unsigned int* numNames)
+{
+    FILE* manifest = (strcmp(manifestName, "-") == 0)
+                     ? stdin : fopen(manifestName, "r");
+    unsigned int capacity = numArgs + 64;
+    char** names = malloc(sizeof(char*) * capacity);
+    char* line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t lineLength;
+    
+    if(!manifest || !names)
+    {
+        if(manifest && manifest != stdin) fclose(manifest);
+        free(names);
+        return NULL;
+    }
+    
+    memcpy(names, args, sizeof(char*) * numArgs);
+    *numNames = numArgs;
+    
+    while((lineLength = getdelim(&line, &lineCapacity, '\0', manifest)) > 0)
+    {
+        // the last name may not be followed by a NUL
+        if(line[lineLength - 1] == '\0')
+        {
+            lineLength--;
+        }
+        if(lineLength == 0)
+        {
+            continue;
+        }
+        
+        if(*numNames == capacity)
+        {
+            capacity *= 2;
+            names = realloc(names, sizeof(char*) * capacity);
+        }
+        names[*numNames] = malloc(lineLength + 1);
+        memcpy(names[*numNames], line, lineLength);
+        names[*numNames][lineLength] = '\0';
+        (*numNames)++;
+    }
+    
+    char readError = ferror(manifest);
+    free(line);
+    if(manifest != stdin) fclose(manifest);
+    
+    if(readError)
+    {
+        for(unsigned int i = numArgs; i < *numNames; i++)
+        {
+            free(names[i]);
+        }
+        free(names);
+        return NULL;
+    }
+    return names;
+}
+
+/* Splits the numNames names passed to the 'b' key, a list of operations that
+ * are each "r NAME" (add or replace), "d NAME" (delete) or "m OLD NEW"
+ * (rename), into the names to add, delete and rename, which are stored in
+ * adds, deletes, renameFrom and renameTo and counted in *numAdds, *numDeletes
+ * and *numRenames. Each array must have room for numNames names.
+ * Returns 0 on success, -1 if names isn't a list of operations. */
+int splitBatch(char** names,
+               unsigned int numNames,
+               char** adds,
+               unsigned int* numAdds,
+               char** deletes,
+               unsigned int* numDeletes,
+               char** renameFrom,
+               char** renameTo,
+               unsigned int* numRenames)
+{
+    unsigned int i = 0;
+    
+    *numAdds = *numDeletes = *numRenames = 0;
+    while(i < numNames)
+    {
+        if(strcmp(names[i], "r") == 0 && i + 1 < numNames)
+        {
+            adds[(*numAdds)++] = names[i+1];
+            i += 2;
+        }
+        else if(strcmp(names[i], "d") == 0 && i + 1 < numNames)
+        {
+            deletes[(*numDeletes)++] = names[i+1];
+            i += 2;
+        }
+        else if(strcmp(names[i], "m") == 0 && i + 2 < numNames)
+        {
+            renameFrom[*numRenames] = names[i+1];
+            renameTo[(*numRenames)++] = names[i+2];
+            i += 3;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
 /* Interprets the arguments passed from the command line and calls
  * the appropriate function in far.h.
  * Returns one of the return codes defined in far.h, or 4 for invalid command
@@ -74,9 +310,19 @@ int main(int argc, char** argv)
     char* archiveName; // The name of the archive passed to Far
     char** filenames; // Pointer to the beginning of the filenames in argv,
                       // or NULL if there are no filenames.
-    unsigned char numFiles; // The number of filenames passed to Far
+    unsigned int numFiles; // The number of filenames passed to Far
     FAR_RTRN returnCode;
     
+    // shift past the options so that argv[1] is the KEY
+    int firstArg = parseOptions(argc, argv);
+    if(firstArg < 0)
+    {
+        invalidArgsError();
+        return 4;
+    }
+    argc -= firstArg - 1;
+    argv += firstArg - 1;
+    
     if(argc < 3) // less than "Far" plus a KEY plus an ARCHIVE
     {
         invalidArgsError();
@@ -84,22 +330,56 @@ int main(int argc, char** argv)
     }
     
     archiveName = argv[2];
+    numFiles = argc - 3;
     
-    if(argc > 3) // if Far was passed at least one filename
+    if(manifestName) // add the filenames listed in the manifest
+    {
+        // stdin can't hold both the manifest and an archive to read
+        if(strcmp(manifestName, "-") == 0 && strcmp(archiveName, "-") == 0 &&
+           strcmp(argv[1], "c") != 0)
+        {
+            invalidArgsError();
+            return 4;
+        }
+        
+        unsigned int numArgs = numFiles;
+        char** names = readManifest(manifestName, &(argv[3]), numArgs,
+                                    &numFiles);
+        if(!names)
+        {
+            fprintf(stderr, "Cannot read manifest: %s\n", manifestName);
+            return OPEN_ERROR;
+        }
+        
+        filenames = (numFiles > 0) ? stripTrailingSlashes(names, numFiles)
+                                   : NULL;
+        for(unsigned int i = numArgs; i < numFiles; i++)
+        {
+            free(names[i]);
+        }
+        free(names);
+    }
+    else if(numFiles > 0) // if Far was passed at least one filename
     {
-        numFiles = argc - 3;
         filenames = stripTrailingSlashes(&(argv[3]), numFiles);
     }
     else
     {
         filenames = NULL;
-        numFiles = 0;
     }
     
     if(strcmp(argv[1], "r") == 0)
     {
         returnCode = farAdd(archiveName, filenames, numFiles);
     }
+    else if(strcmp(argv[1], "u") == 0)
+    {
+        returnCode = farUpdate(archiveName, filenames, numFiles);
+    }
+    else if(strcmp(argv[1], "c") == 0)
+    {
+        returnCode = farCreate(archiveName, filenames, numFiles);
+    }
     else if(strcmp(argv[1], "x") == 0)
     {
         returnCode = farExtract(archiveName, filenames, numFiles);
@@ -108,10 +388,40 @@ int main(int argc, char** argv)
     {
         returnCode = farDelete(archiveName, filenames, numFiles);
     }
+    else if(strcmp(argv[1], "b") == 0)
+    {
+        // one array split into the names to add, delete, and rename from and to
+        char** ops = malloc(sizeof(char*) * (4 * numFiles + 1));
+        unsigned int numAdds, numDeletes, numRenames;
+        
+        if(splitBatch(filenames, numFiles, ops, &numAdds, ops + numFiles,
+                      &numDeletes, ops + 2 * numFiles, ops + 3 * numFiles,
+                      &numRenames) < 0)
+        {
+            invalidArgsError();
+            returnCode = 4;
+        }
+        else
+        {
+            returnCode = farBatch(archiveName, ops, numAdds,
+                                  ops + numFiles, numDeletes,
+                                  ops + 2 * numFiles, ops + 3 * numFiles,
+                                  numRenames);
+        }
+        free(ops);
+    }
     else if(strcmp(argv[1], "t") == 0)
     {
         returnCode = farPrint(archiveName);
     }
+    else if(strcmp(argv[1], "p") == 0)
+    {
+        returnCode = farCompact(archiveName, compactThreshold);
+    }
+    else if(strcmp(argv[1], "v") == 0)
+    {
+        returnCode = farVerify(archiveName);
+    }
     else // first arg is not a valid key
     {
         invalidArgsError();
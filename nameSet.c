@@ -0,0 +1,96 @@
+/*
+ * File:   nameSet.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * A hash set over an array of nul-terminated names.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "nameSet.h"
+
+// the most names per slot before the table is made bigger
+#define NAMESET_MIN_SLOTS_PER_NAME (2)
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* Returns the 32-bit FNV-1a hash of the nul-terminated string name */
+static unsigned int hashName(const char* name)
+{
+    unsigned int hash = 2166136261u;
+
+    for(; *name != '\0'; name++)
+    {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Returns the slot in set that holds name, or the empty slot where name
+ * would go if it isn't in the set. */
+static unsigned int findSlot(nameSet* set, const char* name)
+{
+    unsigned int mask = set->numSlots - 1;
+    unsigned int slot = hashName(name) & mask;
+
+    // linear probing; the table is never full, so this ends
+    while(set->slots[slot] != 0 &&
+          strcmp(set->names[set->slots[slot] - 1], name) != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+nameSet* nameSetNew(char** names, unsigned int numNames)
+{
+    nameSet* set = malloc(sizeof(nameSet));
+
+    if(!set)
+    {
+        return NULL;
+    }
+
+    set->names = names;
+    set->numSlots = 1;
+    while(set->numSlots < numNames * NAMESET_MIN_SLOTS_PER_NAME)
+    {
+        set->numSlots *= 2;
+    }
+
+    set->slots = calloc(set->numSlots, sizeof(unsigned int));
+    if(!set->slots)
+    {
+        free(set);
+        return NULL;
+    }
+
+    // only the first of any repeated names is stored
+    for(unsigned int i = 0; i < numNames; i++)
+    {
+        unsigned int slot = findSlot(set, names[i]);
+        if(set->slots[slot] == 0)
+        {
+            set->slots[slot] = i + 1;
+        }
+    }
+
+    return set;
+}
+
+void nameSetDelete(nameSet* set)
+{
+    free(set->slots);
+    free(set);
+}
+
+int nameSetFind(nameSet* set, const char* name)
+{
+    return (int)set->slots[findSlot(set, name)] - 1;
+}
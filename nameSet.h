@@ -0,0 +1,33 @@
+/*
+ * File:   nameSet.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * A hash set over an array of nul-terminated names, used to find in constant
+ * time whether a name appears in the array.
+ */
+
+#ifndef NAMESET_H
+#define NAMESET_H
+
+typedef struct
+{
+    char** names; // the names in the set; not owned by the nameSet
+    unsigned int* slots; // 1 + the index in names of each slot's name, or 0
+                         // for an empty slot
+    unsigned int numSlots; // the number of slots, a power of 2
+} nameSet;
+
+/* mallocs a nameSet holding the numNames strings in names and returns a
+ * pointer to it. names must outlive the nameSet. Returns NULL upon failure. */
+nameSet* nameSetNew(char** names, unsigned int numNames);
+
+// Frees a nameSet, but not the names it was built from
+void nameSetDelete(nameSet* set);
+
+/* Returns the index in the set's names of the first string equal to name,
+ * or -1 if there's no such string. */
+int nameSetFind(nameSet* set, const char* name);
+
+#endif
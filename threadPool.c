@@ -0,0 +1,397 @@
+/*
+ * File:   threadPool.c
+ * Author: agent (agent@local)
+ *
+ * Created on October 16, 2026
+ *
+ * A fixed set of worker threads that run tasks from a bounded queue, and a
+ * work-stealing pool for tasks that create more tasks.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "threadPool.h"
+
+#define INIT_DEQUE_SIZE (16)
+#define DEQUE_GROWTH_FACTOR (2)
+
+// the argument passed to each thread started by workPoolRun
+typedef struct
+{
+    workPool* pool; // the pool the thread works for
+    unsigned int worker; // the index of the thread's deque
+} workPoolThread;
+
+//////////////////////////// Private functions ///////////////////////////////
+
+/* The body of each worker thread: runs queued tasks until the pool stops */
+static void* threadPoolWorker(void* poolArg)
+{
+    threadPool* pool = poolArg;
+
+    pthread_mutex_lock(&(pool->lock));
+    while(1)
+    {
+        while(pool->numQueued == 0 && !pool->stopping)
+        {
+            pthread_cond_wait(&(pool->taskReady), &(pool->lock));
+        }
+        if(pool->numQueued == 0) // stopping, and nothing is left to run
+        {
+            break;
+        }
+
+        threadPoolItem item = pool->queue[pool->queueStart];
+        pool->queueStart = (pool->queueStart + 1) % pool->sizeQueue;
+        pool->numQueued--;
+        pthread_cond_signal(&(pool->spaceReady));
+
+        pthread_mutex_unlock(&(pool->lock));
+        item.task(item.arg);
+        pthread_mutex_lock(&(pool->lock));
+
+        pool->numPending--;
+        if(pool->numPending == 0)
+        {
+            pthread_cond_broadcast(&(pool->allDone));
+        }
+    }
+    pthread_mutex_unlock(&(pool->lock));
+
+    return NULL;
+}
+
+
+/* Takes an item from deque: the newest if newest is nonzero, else the
+ * oldest. Returns NULL if deque is empty. */
+static void* workDequeTake(workDeque* deque, char newest)
+{
+    void* item = NULL;
+
+    pthread_mutex_lock(&(deque->lock));
+    if(deque->numItems > 0)
+    {
+        unsigned int position = deque->start;
+        if(newest)
+        {
+            position = (deque->start + deque->numItems - 1) % deque->sizeItems;
+        }
+        else
+        {
+            deque->start = (deque->start + 1) % deque->sizeItems;
+        }
+        item = deque->items[position];
+        deque->numItems--;
+    }
+    pthread_mutex_unlock(&(deque->lock));
+
+    return item;
+}
+
+/* Takes the newest item of the given worker, or else steals the oldest item of
+ * another worker. Returns NULL if every deque is empty. */
+static void* workPoolTake(workPool* pool, unsigned int worker)
+{
+    void* item = workDequeTake(&(pool->deques[worker]), 1);
+
+    for(unsigned int i = 1; !item && i < pool->numWorkers; i++)
+    {
+        item = workDequeTake(&(pool->deques[(worker + i) % pool->numWorkers]),
+                             0);
+    }
+
+    if(item)
+    {
+        pthread_mutex_lock(&(pool->lock));
+        pool->numQueued--;
+        pthread_mutex_unlock(&(pool->lock));
+    }
+    return item;
+}
+
+/* Runs items as the given worker until every pushed item has finished */
+static void workPoolWork(workPool* pool, unsigned int worker)
+{
+    while(1)
+    {
+        void* item = workPoolTake(pool, worker);
+
+        if(item)
+        {
+            pool->task(pool, worker, item);
+
+            pthread_mutex_lock(&(pool->lock));
+            pool->numPending--;
+            if(pool->numPending == 0)
+            {
+                pthread_cond_broadcast(&(pool->workReady));
+            }
+            pthread_mutex_unlock(&(pool->lock));
+            continue;
+        }
+
+        // nothing to take; sleep until something is pushed or all is done
+        pthread_mutex_lock(&(pool->lock));
+        while(pool->numQueued == 0 && pool->numPending > 0)
+        {
+            pthread_cond_wait(&(pool->workReady), &(pool->lock));
+        }
+        char done = (pool->numPending == 0);
+        pthread_mutex_unlock(&(pool->lock));
+
+        if(done)
+        {
+            return;
+        }
+    }
+}
+
+/* The body of each thread started by workPoolRun */
+static void* workPoolThreadMain(void* threadArg)
+{
+    workPoolThread* thread = threadArg;
+    workPoolWork(thread->pool, thread->worker);
+    return NULL;
+}
+
+
+///////////////////////////// Public functions ///////////////////////////////
+
+threadPool* threadPoolNew(unsigned int numThreads, unsigned int maxQueued)
+{
+    threadPool* pool = malloc(sizeof(threadPool));
+
+    if(!pool)
+    {
+        return NULL;
+    }
+
+    pool->threads = malloc(sizeof(pthread_t) * numThreads);
+    pool->queue = malloc(sizeof(threadPoolItem) * maxQueued);
+    if(!pool->threads || !pool->queue)
+    {
+        free(pool->threads);
+        free(pool->queue);
+        free(pool);
+        return NULL;
+    }
+
+    pool->sizeQueue = maxQueued;
+    pool->queueStart = 0;
+    pool->numQueued = 0;
+    pool->numPending = 0;
+    pool->stopping = 0;
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->taskReady), NULL);
+    pthread_cond_init(&(pool->spaceReady), NULL);
+    pthread_cond_init(&(pool->allDone), NULL);
+
+    // a pool with fewer threads than asked for still runs every task
+    pool->numThreads = 0;
+    for(unsigned int i = 0; i < numThreads; i++)
+    {
+        if(pthread_create(&(pool->threads[pool->numThreads]),
+                          NULL,
+                          threadPoolWorker,
+                          pool) == 0)
+        {
+            pool->numThreads++;
+        }
+    }
+
+    if(pool->numThreads == 0)
+    {
+        threadPoolDelete(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void threadPoolSubmit(threadPool* pool, threadPoolTask task, void* arg)
+{
+    pthread_mutex_lock(&(pool->lock));
+
+    while(pool->numQueued == pool->sizeQueue)
+    {
+        pthread_cond_wait(&(pool->spaceReady), &(pool->lock));
+    }
+
+    unsigned int end = (pool->queueStart + pool->numQueued) % pool->sizeQueue;
+    pool->queue[end].task = task;
+    pool->queue[end].arg = arg;
+    pool->numQueued++;
+    pool->numPending++;
+    pthread_cond_signal(&(pool->taskReady));
+
+    pthread_mutex_unlock(&(pool->lock));
+}
+
+void threadPoolWait(threadPool* pool)
+{
+    pthread_mutex_lock(&(pool->lock));
+    while(pool->numPending > 0)
+    {
+        pthread_cond_wait(&(pool->allDone), &(pool->lock));
+    }
+    pthread_mutex_unlock(&(pool->lock));
+}
+
+void threadPoolDelete(threadPool* pool)
+{
+    threadPoolWait(pool);
+
+    pthread_mutex_lock(&(pool->lock));
+    pool->stopping = 1;
+    pthread_cond_broadcast(&(pool->taskReady));
+    pthread_mutex_unlock(&(pool->lock));
+
+    for(unsigned int i = 0; i < pool->numThreads; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&(pool->lock));
+    pthread_cond_destroy(&(pool->taskReady));
+    pthread_cond_destroy(&(pool->spaceReady));
+    pthread_cond_destroy(&(pool->allDone));
+    free(pool->threads);
+    free(pool->queue);
+    free(pool);
+}
+
+workPool* workPoolNew(unsigned int numWorkers, workPoolTask task)
+{
+    workPool* pool = malloc(sizeof(workPool));
+
+    if(!pool)
+    {
+        return NULL;
+    }
+
+    pool->deques = malloc(sizeof(workDeque) * numWorkers);
+    if(!pool->deques)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pool->task = task;
+    pool->numWorkers = numWorkers;
+    pool->numQueued = 0;
+    pool->numPending = 0;
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->workReady), NULL);
+
+    for(unsigned int i = 0; i < numWorkers; i++)
+    {
+        pool->deques[i].items = malloc(sizeof(void*) * INIT_DEQUE_SIZE);
+        pool->deques[i].sizeItems = INIT_DEQUE_SIZE;
+        pool->deques[i].start = 0;
+        pool->deques[i].numItems = 0;
+        pthread_mutex_init(&(pool->deques[i].lock), NULL);
+    }
+
+    return pool;
+}
+
+void workPoolPush(workPool* pool, unsigned int worker, void* item)
+{
+    workDeque* deque = &(pool->deques[worker]);
+
+    // count the item first so the pool can't look finished while it's
+    // queued, and so a worker that steals it can't count it out before it's
+    // counted in
+    pthread_mutex_lock(&(pool->lock));
+    pool->numPending++;
+    pool->numQueued++;
+    pthread_mutex_unlock(&(pool->lock));
+
+    pthread_mutex_lock(&(deque->lock));
+    if(deque->numItems == deque->sizeItems)
+    {
+        // grow the deque, unwrapping its items to the front of the new array
+        unsigned int newSize = deque->sizeItems * DEQUE_GROWTH_FACTOR;
+        void** newItems = malloc(sizeof(void*) * newSize);
+        if(!newItems)
+        {
+            pthread_mutex_unlock(&(deque->lock));
+
+            // with no room to queue the item, run it here instead
+            pthread_mutex_lock(&(pool->lock));
+            pool->numQueued--;
+            pthread_mutex_unlock(&(pool->lock));
+
+            pool->task(pool, worker, item);
+
+            pthread_mutex_lock(&(pool->lock));
+            pool->numPending--;
+            if(pool->numPending == 0)
+            {
+                pthread_cond_broadcast(&(pool->workReady));
+            }
+            pthread_mutex_unlock(&(pool->lock));
+            return;
+        }
+        for(unsigned int i = 0; i < deque->numItems; i++)
+        {
+            newItems[i] = deque->items[(deque->start + i) % deque->sizeItems];
+        }
+        free(deque->items);
+        deque->items = newItems;
+        deque->sizeItems = newSize;
+        deque->start = 0;
+    }
+    deque->items[(deque->start + deque->numItems) % deque->sizeItems] = item;
+    deque->numItems++;
+    pthread_mutex_unlock(&(deque->lock));
+
+    pthread_mutex_lock(&(pool->lock));
+    pthread_cond_signal(&(pool->workReady));
+    pthread_mutex_unlock(&(pool->lock));
+}
+
+void workPoolRun(workPool* pool)
+{
+    pthread_t* threads = malloc(sizeof(pthread_t) * pool->numWorkers);
+    workPoolThread* threadArgs =
+        malloc(sizeof(workPoolThread) * pool->numWorkers);
+    unsigned int numStarted = 0;
+
+    // workers that fail to start leave their share to the others
+    for(unsigned int i = 1; threads && threadArgs && i < pool->numWorkers; i++)
+    {
+        threadArgs[numStarted].pool = pool;
+        threadArgs[numStarted].worker = i;
+        if(pthread_create(&(threads[numStarted]),
+                          NULL,
+                          workPoolThreadMain,
+                          &(threadArgs[numStarted])) == 0)
+        {
+            numStarted++;
+        }
+    }
+
+    workPoolWork(pool, 0);
+
+    for(unsigned int i = 0; i < numStarted; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(threadArgs);
+}
+
+void workPoolDelete(workPool* pool)
+{
+    for(unsigned int i = 0; i < pool->numWorkers; i++)
+    {
+        free(pool->deques[i].items);
+        pthread_mutex_destroy(&(pool->deques[i].lock));
+    }
+    pthread_mutex_destroy(&(pool->lock));
+    pthread_cond_destroy(&(pool->workReady));
+    free(pool->deques);
+    free(pool);
+}
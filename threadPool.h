@@ -0,0 +1,104 @@
+/*
+ * File:   threadPool.h
+ * Author: agent
+ *
+ * Created on October 16, 2026
+ *
+ * A fixed set of worker threads that run tasks from a bounded queue, and a
+ * work-stealing pool for tasks that create more tasks.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+
+// a function run by a worker thread, passed the arg it was submitted with
+typedef void (*threadPoolTask)(void* arg);
+
+typedef struct
+{
+    threadPoolTask task; // the function to run
+    void* arg; // the argument to pass to task
+} threadPoolItem;
+
+typedef struct
+{
+    pthread_t* threads; // the worker threads
+    unsigned int numThreads; // the number of elements in threads
+
+    threadPoolItem* queue; // circular queue of tasks waiting to run
+    unsigned int sizeQueue; // the malloc'd size of queue
+    unsigned int queueStart; // the index of the next task to run
+    unsigned int numQueued; // the number of tasks in queue
+
+    unsigned int numPending; // tasks submitted but not yet finished
+    char stopping; // set when the workers should exit
+
+    pthread_mutex_t lock; // guards everything above
+    pthread_cond_t taskReady; // signalled when a task is queued or stopping
+    pthread_cond_t spaceReady; // signalled when a task leaves the queue
+    pthread_cond_t allDone; // signalled when numPending reaches 0
+} threadPool;
+
+/* mallocs a threadPool of numThreads worker threads whose queue holds up to
+ * maxQueued tasks, and returns a pointer to it. Returns NULL upon failure. */
+threadPool* threadPoolNew(unsigned int numThreads, unsigned int maxQueued);
+
+/* Queues task to be run with arg by a worker thread. Blocks while the queue
+ * is full, which bounds the memory held by tasks that haven't run yet. */
+void threadPoolSubmit(threadPool* pool, threadPoolTask task, void* arg);
+
+// Blocks until every task submitted to pool has finished running
+void threadPoolWait(threadPool* pool);
+
+// Waits for every submitted task to finish, then stops and frees the pool
+void threadPoolDelete(threadPool* pool);
+
+typedef struct workPool workPool;
+
+/* the function a workPool runs on each item. worker is the index of the
+ * worker running it, which should be passed to workPoolPush for any items the
+ * task creates. */
+typedef void (*workPoolTask)(workPool* pool, unsigned int worker, void* item);
+
+typedef struct
+{
+    void** items; // circular deque of items waiting to run
+    unsigned int sizeItems; // the malloc'd size of items
+    unsigned int start; // the index of the oldest item
+    unsigned int numItems; // the number of items in the deque
+    pthread_mutex_t lock; // guards everything above
+} workDeque;
+
+struct workPool
+{
+    workPoolTask task; // run on every item
+    workDeque* deques; // one deque per worker
+    unsigned int numWorkers; // the number of elements in deques
+
+    unsigned int numQueued; // items waiting in any deque
+    unsigned int numPending; // items pushed but not yet finished
+    pthread_mutex_t lock; // guards numQueued and numPending
+    pthread_cond_t workReady; // signalled when an item is pushed or all finish
+};
+
+/* mallocs a workPool of numWorkers workers that run task on each item, and
+ * returns a pointer to it. Returns NULL upon failure. */
+workPool* workPoolNew(unsigned int numWorkers, workPoolTask task);
+
+/* Adds item to the deque of the given worker. A worker runs its own newest
+ * item first, so each one works depth-first; idle workers steal the oldest
+ * items of the others. Items pushed before workPoolRun should use worker 0.
+ * If there's no memory to queue item, it's run by the caller instead. */
+void workPoolPush(workPool* pool, unsigned int worker, void* item);
+
+/* Runs every pushed item, and the items they push, until none are left. The
+ * calling thread is worker 0 and the rest are started as threads, so a pool of
+ * one worker starts none. */
+void workPoolRun(workPool* pool);
+
+// Frees a workPool. It must not be running.
+void workPoolDelete(workPool* pool);
+
+#endif